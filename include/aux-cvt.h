@@ -66,6 +66,7 @@
   itoa, itow - int to const char* converter
   atoi, wtoi - const char* to int converter (parser)
   ftoa, ftow - double to const char* converter
+  dtoa, dtow - double to shortest const char* converter
 
 
  */
@@ -193,47 +194,185 @@ namespace pod
       memmove(dst,src,nelements*sizeof(T));
   }
 
-  /** buffer  - in-memory dynamic buffer implementation. **/
+  /** heap_allocator - default allocator of buffer, new[]/delete[] **/
   template <typename T>
-    class buffer
+    struct heap_allocator
     {
+      T*   allocate(size_t n)         { return new T[n]; }
+      void deallocate(T* p, size_t)   { delete[] p; }
+    };
+
+  /** arena - chunked bump-pointer allocator for batches of short lived buffers.
+      Individual deallocations are no-ops, memory is returned by reset() or destructor. **/
+  class arena
+  {
+    struct chunk { chunk* next; size_t size; size_t used; };
+    chunk*  _chunks;
+    size_t  _chunk_size;
+
+    arena(const arena&);
+    arena& operator=(const arena&);
+  public:
+    explicit arena(size_t chunk_size = 16 * 1024): _chunks(0), _chunk_size(chunk_size) {}
+    ~arena() { reset(); }
+
+    void* allocate(size_t sz)
+    {
+      const size_t align = sizeof(void*) * 2;
+      sz = (sz + align - 1) & ~(align - 1);
+      if (!_chunks || _chunks->size - _chunks->used < sz)
+      {
+        size_t csz = std::max(_chunk_size, sz);
+        chunk* c = (chunk*)malloc(sizeof(chunk) + align + csz);
+        if (!c) return 0;
+        c->next = _chunks; c->size = csz; c->used = 0;
+        _chunks = c;
+      }
+      BYTE* base = (BYTE*)(_chunks + 1);
+      base += (align - (size_t(base) & (align - 1))) & (align - 1);
+      void* p = base + _chunks->used;
+      _chunks->used += sz;
+      return p;
+    }
+
+    void reset()
+    {
+      while (_chunks) { chunk* n = _chunks->next; free(_chunks); _chunks = n; }
+    }
+  };
+
+  /** arena_allocator - buffer allocator drawing memory from the arena **/
+  template <typename T>
+    struct arena_allocator
+    {
+      arena* _arena;
+      arena_allocator(arena& a): _arena(&a) {}
+      T*   allocate(size_t n)         { return (T*)_arena->allocate(n * sizeof(T)); }
+      void deallocate(T*, size_t)     {}
+    };
+
+  /** buffer  - in-memory dynamic buffer implementation, string builder.
+      N - number of elements stored inline, heap (allocator A) is used only when content outgrows them,
+      at least one - for the terminator of empty content.
+      Content is always zero terminated so data() is pure accessor. **/
+  template <typename T, size_t N = (sizeof(T) < 128 ? 128 / sizeof(T) : 1), class A = heap_allocator<T> >
+    class buffer : private A
+    {
+#ifdef CPP11
+      static_assert(N > 0, "inline storage shall hold at least the terminator");
+#endif
       T*              _body;
       size_t          _allocated;
       size_t          _size;
+      T               _local[N];
+
+      bool is_local() const { return _body == _local; }
 
       T*  reserve(size_t size)
       {
         size_t newsize = _size + size;
-        if( newsize > _allocated )
+        if( newsize >= _allocated )
         {
-          _allocated = (_allocated * 3) / 2;
-          if(_allocated < newsize) _allocated = newsize;
-          T *newbody = new T[_allocated];
-          copy(newbody,_body,_size);
-          delete[] _body;
+          size_t allocated = (_allocated * 3) / 2;
+          if(allocated <= newsize) allocated = newsize + 1;
+          T *newbody = A::allocate(allocated);
+          copy(newbody,_body,_size + 1);
+          if(!is_local()) A::deallocate(_body,_allocated);
           _body = newbody;
+          _allocated = allocated;
         }
         return _body + _size;
       }
 
+      void reset_local() { _body = _local; _allocated = N; _size = 0; _local[0] = 0; }
+
+      void steal(buffer& other)
+      {
+        if(other.is_local())
+        {
+          reset_local();
+          push(other._body, other._size);
+        }
+        else
+        {
+          _body = other._body; _allocated = other._allocated; _size = other._size;
+          other.reset_local();
+        }
+      }
+
     public:
 
-      buffer():_size(0)        { _body = new T[_allocated = 256]; }
-      ~buffer()                { delete[] _body;  }
+      buffer()                      { reset_local(); }
+      explicit buffer(const A& a): A(a) { reset_local(); }
+      buffer(const buffer& other): A(other) { reset_local(); push(other._body, other._size); }
+      ~buffer()                     { if(!is_local()) A::deallocate(_body,_allocated); }
 
-      const T * data() const
+      buffer& operator = (const buffer& other)
       {
-         buffer* self = const_cast<buffer*>(this);
-         if(_size == _allocated) self->reserve(1);
-         self->_body[_size] = 0; return _body;
+        if(this != &other) { clear(); push(other._body, other._size); }
+        return *this;
       }
 
+#ifdef CPP11
+      buffer(buffer&& other): A(other) { steal(other); }
+      buffer& operator = (buffer&& other)
+      {
+        if(this != &other)
+        {
+          if(!is_local()) A::deallocate(_body,_allocated);
+          A::operator=(other);
+          steal(other);
+        }
+        return *this;
+      }
+#endif
+
+      void swap(buffer& other)
+      {
+        if(!is_local() && !other.is_local())
+        {
+          std::swap(_body, other._body);
+          std::swap(_allocated, other._allocated);
+          std::swap(_size, other._size);
+          std::swap(static_cast<A&>(*this), static_cast<A&>(other));
+          return;
+        }
+        // heap body goes along with the allocator that has to free it
+        buffer t(static_cast<const A&>(*this));
+        t.steal(*this);
+        A::operator=(static_cast<const A&>(other));
+        steal(other);
+        static_cast<A&>(other) = static_cast<const A&>(t);
+        other.steal(t);
+      }
+
+      const T * data() const        { return _body; }
       size_t length() const         { return _size; }
 
-      void push(T c)                { *reserve(1) = c; ++_size; }
-      void push(const T *pc, size_t sz) { copy(reserve(sz),pc,sz); _size += sz; }
+      void push(T c)                { T* p = reserve(1); p[0] = c; p[1] = 0; ++_size; }
+      void push(const T *pc, size_t sz) { T* p = reserve(sz); copy(p,pc,sz); p[sz] = 0; _size += sz; }
+
+      // grows buffer by n elements and returns pointer to them, caller fills them in.
+      // Allocates at most once when used on empty buffer with precomputed length.
+      T*   append_uninitialized(size_t n) { T* p = reserve(n); p[n] = 0; _size += n; return p; }
+
+      void clear()                  { _size = 0; _body[0] = 0; }
 
-      void clear()                  { _size = 0; }
+      // detaches zero terminated content from the buffer, buffer becomes empty.
+      // Caller owns the block and frees it by allocator's deallocate() - delete[] for heap_allocator.
+      // Content held inline is copied to the allocator's memory first.
+      T* release(size_t* plength = 0)
+      {
+        T* p = _body;
+        if(plength) *plength = _size;
+        if(is_local())
+        {
+          p = A::allocate(_size + 1);
+          copy(p,_body,_size + 1);
+        }
+        reset_local();
+        return p;
+      }
 
     };
 
@@ -244,74 +383,295 @@ namespace pod
 
 namespace utf8
 {
-  // convert utf8 code unit sequence to WCHAR sequence
+  // ASCII run kernels, used as fast paths by towcs() and fromwcs():
+  //   widen_ascii()  - copies leading run of non-zero 7-bit bytes as WCHARs
+  //   narrow_ascii() - copies leading run of WCHARs < 0x80 as bytes
+  // both return length of the run copied. 16 (SSE2, NEON) or 32 (AVX2) units per iteration.
+  // dst may be NULL - run is measured but not copied.
 
-  inline bool towcs(const BYTE *utf8, size_t length, pod::wchar_buffer& outbuf)
+  inline size_t widen_ascii_scalar(const BYTE* src, size_t n, WCHAR* dst)
   {
-    if(!utf8 || length == 0) return true;
-    const BYTE* pc = (const BYTE*)utf8;
-    const BYTE* last = pc + length;
-    unsigned int b;
-    unsigned int num_errors = 0;
-    while (pc < last)
+    size_t i = 0;
+    for (; i < n; ++i) {
+      BYTE b = src[i];
+      if (b == 0 || (b & 0x80)) break;
+      if (dst) dst[i] = WCHAR(b);
+    }
+    return i;
+  }
+
+  inline size_t narrow_ascii_scalar(const WCHAR* src, size_t n, BYTE* dst)
+  {
+    size_t i = 0;
+    for (; i < n; ++i) {
+      WCHAR c = src[i];
+      if (c >= 0x80) break;
+      if (dst) dst[i] = BYTE(c);
+    }
+    return i;
+  }
+
+#if defined(AUX_SSE2)
+  inline size_t widen_ascii_sse2(const BYTE* src, size_t n, WCHAR* dst)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+      // high bit set - non-ASCII byte, cmpeq - zero byte (eos)
+      if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero))))
+        break;
+      if (!dst) continue;
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(v, zero));
+      _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    return i + widen_ascii_scalar(src + i, n - i, dst ? dst + i : 0);
+  }
+
+  inline size_t narrow_ascii_sse2(const WCHAR* src, size_t n, BYTE* dst)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i high = _mm_set1_epi16(short(0xFF80));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 8));
+      __m128i h = _mm_and_si128(_mm_or_si128(a, b), high);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(h, zero)) != 0xFFFF)
+        break;
+      if (dst) _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+    return i + narrow_ascii_scalar(src + i, n - i, dst ? dst + i : 0);
+  }
+#endif
+
+#if defined(AUX_AVX2)
+  AUX_TARGET_AVX2 inline size_t widen_ascii_avx2(const BYTE* src, size_t n, WCHAR* dst)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+      if (_mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, zero))))
+        break;
+      if (!dst) continue;
+      _mm256_storeu_si256((__m256i*)(dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+      _mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+    }
+    return i + widen_ascii_sse2(src + i, n - i, dst ? dst + i : 0);
+  }
+
+  AUX_TARGET_AVX2 inline size_t narrow_ascii_avx2(const WCHAR* src, size_t n, BYTE* dst)
+  {
+    const __m256i high = _mm256_set1_epi16(short(0xFF80));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+      if (!_mm256_testz_si256(_mm256_or_si256(a, b), high))
+        break;
+      if (!dst) continue;
+      // packus works per 128-bit lane, restore order of 64-bit quads
+      __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+      _mm256_storeu_si256((__m256i*)(dst + i), p);
+    }
+    return i + narrow_ascii_sse2(src + i, n - i, dst ? dst + i : 0);
+  }
+#endif
+
+#if defined(AUX_NEON)
+  inline size_t widen_ascii_neon(const BYTE* src, size_t n, WCHAR* dst)
+  {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      uint8x16_t v = vld1q_u8(src + i);
+      if (vmaxvq_u8(vorrq_u8(v, vceqzq_u8(v))) >= 0x80)
+        break;
+      if (!dst) continue;
+      vst1q_u16((uint16_t*)(dst + i), vmovl_u8(vget_low_u8(v)));
+      vst1q_u16((uint16_t*)(dst + i + 8), vmovl_high_u8(v));
+    }
+    return i + widen_ascii_scalar(src + i, n - i, dst ? dst + i : 0);
+  }
+
+  inline size_t narrow_ascii_neon(const WCHAR* src, size_t n, BYTE* dst)
+  {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      uint16x8_t a = vld1q_u16((const uint16_t*)(src + i));
+      uint16x8_t b = vld1q_u16((const uint16_t*)(src + i + 8));
+      if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+        break;
+      if (dst) vst1q_u8(dst + i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    }
+    return i + narrow_ascii_scalar(src + i, n - i, dst ? dst + i : 0);
+  }
+#endif
+
+  inline size_t widen_ascii(const BYTE* src, size_t n, WCHAR* dst)
+  {
+#if defined(AUX_AVX2)
+    if (n >= 32 && aux::cpu_has_avx2())
+      return widen_ascii_avx2(src, n, dst);
+#endif
+#if defined(AUX_SSE2)
+    return widen_ascii_sse2(src, n, dst);
+#elif defined(AUX_NEON)
+    return widen_ascii_neon(src, n, dst);
+#else
+    return widen_ascii_scalar(src, n, dst);
+#endif
+  }
+
+  inline size_t narrow_ascii(const WCHAR* src, size_t n, BYTE* dst)
+  {
+#if defined(AUX_AVX2)
+    if (n >= 32 && aux::cpu_has_avx2())
+      return narrow_ascii_avx2(src, n, dst);
+#endif
+#if defined(AUX_SSE2)
+    return narrow_ascii_sse2(src, n, dst);
+#elif defined(AUX_NEON)
+    return narrow_ascii_neon(src, n, dst);
+#else
+    return narrow_ascii_scalar(src, n, dst);
+#endif
+  }
+
+  // transcoder outputs: measuring pass and filling pass over single preallocated block.
+  template <typename T>
+    struct measure_sink
     {
-      b = *pc++;
+      size_t n;
+      bool   empty; // output was empty before conversion
+      measure_sink(bool e): n(0), empty(e) {}
+      void   push(T) { ++n; }
+      T*     target() { return 0; }
+      void   advance(size_t sz) { n += sz; }
+      bool   at_start() const { return empty && n == 0; }
+    };
 
-      if( !b ) break; // 0 - is eos in all utf encodings
+  template <typename T>
+    struct fill_sink
+    {
+      T*     start;
+      T*     p;
+      bool   empty;
+      fill_sink(T* s, bool e): start(s), p(s), empty(e) {}
+      void   push(T c) { *p++ = c; }
+      T*     target() { return p; }
+      void   advance(size_t sz) { p += sz; }
+      bool   at_start() const { return empty && p == start; }
+    };
 
-      if ((b & 0x80) == 0)
-      {
-        // 1-BYTE sequence: 000000000xxxxxxx = 0xxxxxxx
-        ;
-      }
-      else if ((b & 0xe0) == 0xc0)
-      {
-        // 2-BYTE sequence: 00000yyyyyxxxxxx = 110yyyyy 10xxxxxx
-        if(pc == last) { outbuf.push('?'); ++num_errors; break; }
-        b = (b & 0x1f) << 6;
-        b |= (*pc++ & 0x3f);
-      }
-      else if ((b & 0xf0) == 0xe0)
-      {
-        // 3-BYTE sequence: zzzzyyyyyyxxxxxx = 1110zzzz 10yyyyyy 10xxxxxx
-        if(pc >= last - 1) { outbuf.push('?'); ++num_errors; break; }
-
-        b = (b & 0x0f) << 12;
-        b |= (*pc++ & 0x3f) << 6;
-        b |= (*pc++ & 0x3f);
-        if(b == 0xFEFF &&
-           outbuf.length() == 0) // bom at start
-             continue; // skip it
-      }
-      else if ((b & 0xf8) == 0xf0)
+  // utf8 -> WCHAR conversion core, returns number of errors
+  // strict == true - validating mode: malformed sequences (bad continuation bytes,
+  //                  overlong forms, surrogates, code points above 0x10FFFF) are replaced by '?'
+  //                  one lead byte at a time and counted as errors.
+  template <class SINK>
+    inline unsigned int decode(const BYTE* pc, const BYTE* last, SINK& out, bool strict)
+    {
+      unsigned int b;
+      unsigned int num_errors = 0;
+      while (pc < last)
       {
-        // 4-BYTE sequence: 11101110wwwwzzzzyy + 110111yyyyxxxxxx = 11110uuu 10uuzzzz 10yyyyyy 10xxxxxx
-        if(pc >= last - 2) { outbuf.push('?'); break; }
-
-        b = (b & 0x07) << 18;
-        b |= (*pc++ & 0x3f) << 12;
-        b |= (*pc++ & 0x3f) << 6;
-        b |= (*pc++ & 0x3f);
-        // b shall contain now full 21-bit unicode code point.
-        assert((b & 0x1fffff) == b);
-        if((b & 0x1fffff) != b)
+        if (*pc && (*pc & 0x80) == 0)
         {
-          outbuf.push('?');
-          ++num_errors;
+          // run of 1-BYTE sequences
+          size_t n = widen_ascii(pc, last - pc, out.target());
+          out.advance(n);
+          pc += n;
           continue;
         }
-        outbuf.push( WCHAR(0xd7c0 + (b >> 10)) );
-        outbuf.push( WCHAR(0xdc00 | (b & 0x3ff)) );
+
+        const BYTE* lead = pc;
+        b = *pc++;
+
+        if( !b ) break; // 0 - is eos in all utf encodings
+
+        if ((b & 0xe0) == 0xc0)
+        {
+          // 2-BYTE sequence: 00000yyyyyxxxxxx = 110yyyyy 10xxxxxx
+          if(pc == last) { out.push('?'); ++num_errors; break; }
+          if (strict && ((pc[0] & 0xc0) != 0x80 || b < 0xc2)) goto MALFORMED;
+          b = (b & 0x1f) << 6;
+          b |= (*pc++ & 0x3f);
+        }
+        else if ((b & 0xf0) == 0xe0)
+        {
+          // 3-BYTE sequence: zzzzyyyyyyxxxxxx = 1110zzzz 10yyyyyy 10xxxxxx
+          if(pc >= last - 1) { out.push('?'); ++num_errors; break; }
+          if (strict && ((pc[0] & 0xc0) != 0x80 || (pc[1] & 0xc0) != 0x80)) goto MALFORMED;
+
+          b = (b & 0x0f) << 12;
+          b |= (*pc++ & 0x3f) << 6;
+          b |= (*pc++ & 0x3f);
+          if (strict && (b < 0x800 || (b >= 0xD800 && b <= 0xDFFF))) goto MALFORMED;
+          if(b == 0xFEFF && out.at_start()) // bom at start
+            continue; // skip it
+        }
+        else if ((b & 0xf8) == 0xf0)
+        {
+          // 4-BYTE sequence: 11101110wwwwzzzzyy + 110111yyyyxxxxxx = 11110uuu 10uuzzzz 10yyyyyy 10xxxxxx
+          if(pc >= last - 2) { out.push('?'); break; }
+          if (strict && ((pc[0] & 0xc0) != 0x80 || (pc[1] & 0xc0) != 0x80 || (pc[2] & 0xc0) != 0x80)) goto MALFORMED;
+
+          b = (b & 0x07) << 18;
+          b |= (*pc++ & 0x3f) << 12;
+          b |= (*pc++ & 0x3f) << 6;
+          b |= (*pc++ & 0x3f);
+          if (strict && (b < 0x10000 || b > 0x10FFFF)) goto MALFORMED;
+          // b shall contain now full 21-bit unicode code point.
+          assert((b & 0x1fffff) == b);
+          if((b & 0x1fffff) != b)
+          {
+            out.push('?');
+            ++num_errors;
+            continue;
+          }
+          out.push( WCHAR(0xd7c0 + (b >> 10)) );
+          out.push( WCHAR(0xdc00 | (b & 0x3ff)) );
+          continue;
+        }
+        else if (strict)
+          goto MALFORMED;
+        else
+        {
+          assert(0); //bad start of UTF-8 multi-BYTE sequence"
+          ++num_errors;
+          b = '?';
+        }
+        out.push( WCHAR(b) );
         continue;
-      }
-      else
-      {
-        assert(0); //bad start of UTF-8 multi-BYTE sequence"
+      MALFORMED:
+        out.push('?');
         ++num_errors;
-        b = '?';
+        pc = lead + 1; // resync on next byte
       }
-      outbuf.push( WCHAR(b) );
+      return num_errors;
     }
+
+  // exact number of WCHARs towcs() will produce
+  inline size_t towcs_length(const BYTE *utf8, size_t length, bool strict = false)
+  {
+    if(!utf8 || length == 0) return 0;
+    measure_sink<WCHAR> m(true);
+    decode(utf8, utf8 + length, m, strict);
+    return m.n;
+  }
+
+  // convert utf8 code unit sequence to WCHAR sequence,
+  // appends to outbuf in single allocation, see decode() for the meaning of strict
+  template <size_t N, class A>
+  inline bool towcs(const BYTE *utf8, size_t length, pod::buffer<WCHAR,N,A>& outbuf, bool strict = false)
+  {
+    if(!utf8 || length == 0) return true;
+    bool empty = outbuf.length() == 0;
+    measure_sink<WCHAR> m(empty);
+    decode(utf8, utf8 + length, m, strict);
+    fill_sink<WCHAR> f(outbuf.append_uninitialized(m.n), empty);
+    unsigned int num_errors = decode(utf8, utf8 + length, f, strict);
+    assert(size_t(f.p - f.start) == m.n);
     return num_errors == 0;
   }
 
@@ -357,38 +717,85 @@ namespace utf8
     return true;
   }
   
-  inline bool fromwcs(aux::wchars buf, pod::byte_buffer& outbuf)
-  {
-    unsigned int  num_errors = 0;
-    unsigned int  c; // unicode code point
-
-    while(get_ucp(buf,c))
+  // WCHAR -> utf8 conversion core, returns number of errors
+  // strict == true - validating mode: unpaired surrogates are replaced by '?' and counted as errors.
+  template <class SINK>
+    inline unsigned int encode(aux::wchars buf, SINK& out, bool strict)
     {
-      if (c < (1 << 7))
-      {
-        outbuf.push(BYTE(c));
-      }
-      else if (c < (1 << 11))
-      {
-        outbuf.push(BYTE((c >> 6) | 0xc0));
-        outbuf.push(BYTE((c & 0x3f) | 0x80));
-      }
-      else if (c < (1 << 16))
-      {
-        outbuf.push(BYTE((c >> 12) | 0xe0));
-        outbuf.push(BYTE(((c >> 6) & 0x3f) | 0x80));
-        outbuf.push(BYTE((c & 0x3f) | 0x80));
-      }
-      else if (c < (1 << 21))
+      unsigned int  num_errors = 0;
+      unsigned int  c; // unicode code point
+
+      while(buf.length)
       {
-        outbuf.push(BYTE((c >> 18) | 0xf0));
-        outbuf.push(BYTE(((c >> 12) & 0x3f) | 0x80));
-        outbuf.push(BYTE(((c >> 6) & 0x3f) | 0x80));
-        outbuf.push(BYTE((c & 0x3f) | 0x80));
+        if (*buf.start < 0x80)
+        {
+          // run of ASCII chars
+          size_t n = narrow_ascii(buf.start, buf.length, out.target());
+          out.advance(n);
+          buf.prune(n);
+          continue;
+        }
+        if (strict)
+        {
+          WCHAR c0 = buf.start[0];
+          bool high = c0 >= 0xD800 && c0 <= 0xDBFF;
+          bool paired = high && buf.length > 1 && buf.start[1] >= 0xDC00 && buf.start[1] <= 0xDFFF;
+          if ((high && !paired) || (c0 >= 0xDC00 && c0 <= 0xDFFF))
+          {
+            out.push(BYTE('?'));
+            ++num_errors;
+            buf.prune(1);
+            continue;
+          }
+        }
+        if (!get_ucp(buf,c))
+          break;
+        if (c < (1 << 7))
+        {
+          out.push(BYTE(c));
+        }
+        else if (c < (1 << 11))
+        {
+          out.push(BYTE((c >> 6) | 0xc0));
+          out.push(BYTE((c & 0x3f) | 0x80));
+        }
+        else if (c < (1 << 16))
+        {
+          out.push(BYTE((c >> 12) | 0xe0));
+          out.push(BYTE(((c >> 6) & 0x3f) | 0x80));
+          out.push(BYTE((c & 0x3f) | 0x80));
+        }
+        else if (c < (1 << 21))
+        {
+          out.push(BYTE((c >> 18) | 0xf0));
+          out.push(BYTE(((c >> 12) & 0x3f) | 0x80));
+          out.push(BYTE(((c >> 6) & 0x3f) | 0x80));
+          out.push(BYTE((c & 0x3f) | 0x80));
+        }
+        else
+          ++num_errors;
       }
-      else
-        ++num_errors;
+      return num_errors;
     }
+
+  // exact number of bytes fromwcs() will produce
+  inline size_t fromwcs_length(aux::wchars buf, bool strict = false)
+  {
+    measure_sink<BYTE> m(true);
+    encode(buf, m, strict);
+    return m.n;
+  }
+
+  // convert WCHAR sequence to utf8 code unit sequence,
+  // appends to outbuf in single allocation, see encode() for the meaning of strict
+  template <size_t N, class A>
+  inline bool fromwcs(aux::wchars buf, pod::buffer<BYTE,N,A>& outbuf, bool strict = false)
+  {
+    measure_sink<BYTE> m(true);
+    encode(buf, m, strict);
+    fill_sink<BYTE> f(outbuf.append_uninitialized(m.n), true);
+    unsigned int num_errors = encode(buf, f, strict);
+    assert(size_t(f.p - f.start) == m.n);
     return num_errors == 0;
   }
 
@@ -743,19 +1150,11 @@ namespace aux
 template<typename CT>
   class itot
   {
-    CT buffer[38];
+    CT buffer[66];
   public:
     itot(int n, int radix = 10)
     {
-      static char num[] = "0123456789abcdefghijklmnopqrstuvwxyz";
-	  	CT* wstr = buffer;
-    	if (radix < 2 || radix > 35) { *wstr = 0; return; }   // validate radix
-		  int sign = n;	if (sign < 0) n = -n;
-		  do { *wstr++ = num[n % radix]; } while( n /= radix ); // conversion. number is reversed.
-	    if(sign<0) *wstr++ ='-';
-	    *wstr = 0;
-	    // reverse the string
-      std::reverse(buffer,wstr);
+      format_int(buffer, n, unsigned(radix));
     }
     operator const CT*() { return buffer; }
   };
@@ -764,6 +1163,21 @@ template<typename CT>
   typedef itot<WCHAR> itow;
 
 
+  /** Double to string converter, shortest form that reads back to the same value.
+      Use it as wostream << dtow(0.1)
+  **/
+template<typename CT>
+  class dtot
+  {
+    CT buffer[32];
+  public:
+    dtot(double d) { format_double(buffer, d); }
+    operator const CT*() { return buffer; }
+  };
+
+  typedef dtot<char> dtoa;
+  typedef dtot<WCHAR> dtow;
+
   /** Float to string converter.
       Use it as ostream << ftoa(234.1); or
       Use it as ostream << ftoa(234.1,"pt"); or
@@ -774,7 +1188,12 @@ template<typename CT>
   public:
     ftoa(double d, const char* units = "", int fractional_digits = 1)
     {
-      snprintf(buffer, sizeof(buffer), "%.*f%s", fractional_digits, d, units );
+      int n = snprintf(buffer, sizeof(buffer), "%.*f", fractional_digits, d );
+      if (n < 0 || n >= int(sizeof(buffer))) n = int(sizeof(buffer)) - 1;
+      // CRT is locale dependent, fix decimal point
+      for (int i = 0; i < n; ++i)
+        if (buffer[i] == ',') buffer[i] = '.';
+      snprintf(buffer + n, sizeof(buffer) - n, "%s", units);
       buffer[63] = 0;
     }
     operator const char*() { return buffer; }
@@ -804,16 +1223,20 @@ template<typename CT>
    inline int atoi(const char *s, int default_value = 0)
   {
     if( !s ) return default_value;
-    char *lastptr;
-    long i = strtol( s, &lastptr, 10 );
-    return (lastptr != s)? (int)i : default_value;
+    chars t = trim_left(chars_of(s));
+    int64_t i = 0;
+    if( !parse_int(t, i) ) return default_value;
+    return int(i < INT_MIN ? INT_MIN : i > INT_MAX ? INT_MAX : i);
   }
 
  /** wstring to integer parser. **/
   inline int wtoi(const WCHAR *s, int default_value = 0)
   {
-    w2a at(s);
-    return atoi(at.c_str(),default_value);
+    if( !s ) return default_value;
+    wchars t = trim_left(chars_of(s));
+    int64_t i = 0;
+    if( !parse_int(t, i) ) return default_value;
+    return int(i < INT_MIN ? INT_MIN : i > INT_MAX ? INT_MAX : i);
   }
 
   // class T must have two methods:
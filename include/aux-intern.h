@@ -0,0 +1,110 @@
+// Copyright(c) 2024  Case Technologies 
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __aux_intern_h__
+#define __aux_intern_h__
+
+/*
+ * Process wide interning of names:
+ *
+ *   aux::fnv1a(s)          - FNV-1a hash, constexpr so literals get hashed at compile time,
+ *                            see AUX_HASH("literal")
+ *   aux::intern_table<V,N> - lock-free bounded open addressing table name -> V,
+ *                            V is computed once per name by the factory given to get().
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+namespace aux
+{
+  const uint64_t FNV1A_BASIS = 14695981039346656037ULL;
+  const uint64_t FNV1A_PRIME = 1099511628211ULL;
+
+  constexpr uint64_t fnv1a(const char* s, uint64_t h = FNV1A_BASIS)
+  {
+    return *s ? fnv1a(s + 1, (h ^ uint64_t(uint8_t(*s))) * FNV1A_PRIME) : h;
+  }
+
+  // hash of string literal, guaranteed to be computed at compile time
+  #define AUX_HASH(literal) (std::integral_constant<uint64_t, aux::fnv1a(literal)>::value)
+
+  // V shall be trivial type (it lives in zero initialized static storage),
+  // entries are never removed: names and values stay for the lifetime of the process.
+  // When the table gets full get() returns nullptr and callers fall back to their uncached path.
+  template <typename V, unsigned CAPACITY = 4096>
+    class intern_table
+    {
+      struct slot
+      {
+        std::atomic<uint64_t> hash;   // 0 - free, taken by CAS
+        std::atomic<int>      ready;  // 1 - name and val are published
+        const char*           name;
+        V                     val;
+      };
+      slot _slots[CAPACITY];
+
+      static uint64_t nonzero(uint64_t h) { return h ? h : 1; }
+
+    public:
+      // instances must have static storage duration
+      intern_table() {}
+
+      // V for name, factory(name, V&) gets called once per name
+      template <typename F>
+        const V* get(const char* name, uint64_t hash, F factory)
+        {
+          hash = nonzero(hash);
+          for (unsigned i = 0, at = unsigned(hash % CAPACITY); i < CAPACITY; ++i, at = (at + 1) % CAPACITY)
+          {
+            slot& s = _slots[at];
+            uint64_t h = s.hash.load(std::memory_order_acquire);
+            if (h == 0) {
+              uint64_t expected = 0;
+              if (s.hash.compare_exchange_strong(expected, hash, std::memory_order_acq_rel)) {
+                size_t n = strlen(name);
+                char* copy = new char[n + 1]; // lives forever
+                memcpy(copy, name, n + 1);
+                s.name = copy;
+                factory(name, s.val);
+                s.ready.store(1, std::memory_order_release);
+                return &s.val;
+              }
+              h = expected; // someone else took it
+            }
+            if (h != hash) continue;
+            while (!s.ready.load(std::memory_order_acquire))
+              std::this_thread::yield();
+            if (strcmp(s.name, name) == 0)
+              return &s.val;
+          }
+          return nullptr;
+        }
+
+      template <typename F>
+        const V* get(const char* name, F factory) { return get(name, fnv1a(name), factory); }
+    };
+
+}
+
+#endif
@@ -59,6 +59,63 @@
   #error "Unknown platform"
 #endif
 
+// SIMD instruction sets usable without extra compiler flags:
+// SSE2 is baseline on x86-64, NEON - on ARM64.
+// AVX2 code paths are compiled in as well but get selected at runtime (aux::cpu_has_avx2()).
+// Define AUX_NO_SIMD to force scalar code.
+#if !defined(AUX_NO_SIMD)
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define AUX_SSE2
+    #if defined(_MSC_VER)
+      #define AUX_AVX2
+      #define AUX_TARGET_AVX2
+    #elif defined(__GNUC__) || defined(__clang__)
+      #define AUX_AVX2
+      #define AUX_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+  #elif defined(__aarch64__) || defined(_M_ARM64)
+    #define AUX_NEON
+  #endif
+#endif
+
+#if defined(AUX_SSE2)
+  #include <emmintrin.h>
+  #if defined(AUX_AVX2)
+    #include <immintrin.h>
+  #endif
+#elif defined(AUX_NEON)
+  #include <arm_neon.h>
+#endif
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+#if defined(__cplusplus)
+namespace aux
+{
+  // true if CPU and OS support AVX2, evaluated once
+  inline bool cpu_has_avx2()
+  {
+#if defined(AUX_AVX2) && defined(_MSC_VER)
+    static const bool has = []() -> bool {
+      int r[4];
+      __cpuid(r, 1);
+      bool osxsave = (r[2] & (1 << 27)) != 0;
+      if (!osxsave || (_xgetbv(0) & 6) != 6) return false;
+      __cpuidex(r, 7, 0);
+      return (r[1] & (1 << 5)) != 0;
+    }();
+    return has;
+#elif defined(AUX_AVX2)
+    static const bool has = __builtin_cpu_supports("avx2") != 0;
+    return has;
+#else
+    return false;
+#endif
+  }
+}
+#endif
+
 #if defined(WINDOWS)
   #define stricmp _stricmp
   #define wcsicmp _wcsicmp
@@ -40,9 +40,30 @@
  **/
 
 #include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <locale.h>
 #include "limits.h"
 #include <vector>
 #include "azurite-types.h"
+#include "aux-platform.h"
+#if defined(OSX)
+  #include <xlocale.h>
+#endif
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L
+  #if defined(__has_include)
+    #if __has_include(<charconv>)
+      #include <charconv>
+      #if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        #define AUX_TO_CHARS_DOUBLE
+      #endif
+    #endif
+  #endif
+#endif
 
 namespace aux
 {
@@ -53,7 +74,7 @@ namespace aux
   inline bool is_digit( char c ) { return isdigit(c & 0xff) != 0; }
   inline bool is_digit( WCHAR c ) { return iswdigit(c) != 0; }
 
-  inline bool is_xdigit( char c ) { return isdigit(c & 0xff) != 0; }
+  inline bool is_xdigit( char c ) { return isxdigit(c & 0xff) != 0; }
   inline bool is_xdigit( WCHAR c ) { return iswxdigit(c) != 0; }
 
   inline bool is_alpha( char c ) { return isalpha(c & 0xff) != 0; }
@@ -65,6 +86,254 @@ namespace aux
   template<typename CT>
     inline size_t wcslen( const CT* s ) { const CT *p = s; while (*p) p++; return p - s; }
 
+  // element and subsequence search primitives, slice::index_of() and friends are built on them.
+  // All return pointer to the element found or NULL.
+  // Generic versions are plain loops, char, BYTE and WCHAR get memchr / SIMD versions,
+  // subsequences are located by "first+last element" filtering over 16 byte blocks.
+
+  // index of lowest/highest set bit, m != 0
+  inline unsigned lowest_bit(uint64_t m)
+  {
+#if defined(_MSC_VER) && defined(X64BITS)
+    unsigned long i; _BitScanForward64(&i, m); return unsigned(i);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    if (uint32_t(m)) { _BitScanForward(&i, uint32_t(m)); return unsigned(i); }
+    _BitScanForward(&i, uint32_t(m >> 32)); return unsigned(i) + 32;
+#else
+    return unsigned(__builtin_ctzll(m));
+#endif
+  }
+  inline unsigned highest_bit(uint64_t m)
+  {
+#if defined(_MSC_VER) && defined(X64BITS)
+    unsigned long i; _BitScanReverse64(&i, m); return unsigned(i);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    if (uint32_t(m >> 32)) { _BitScanReverse(&i, uint32_t(m >> 32)); return unsigned(i) + 32; }
+    _BitScanReverse(&i, uint32_t(m)); return unsigned(i);
+#else
+    return 63u - unsigned(__builtin_clzll(m));
+#endif
+  }
+
+  template <typename T>
+    inline bool equal_elements(const T* a, const T* b, size_t n)
+    {
+      for (size_t i = 0; i < n; ++i) if (a[i] != b[i]) return false;
+      return true;
+    }
+
+  template <typename T>
+    inline const T* find_element(const T* s, size_t n, T e)
+    {
+      for (size_t i = 0; i < n; ++i) if (s[i] == e) return s + i;
+      return 0;
+    }
+
+  template <typename T>
+    inline const T* find_last_element(const T* s, size_t n, T e)
+    {
+      for (size_t i = n; i > 0;) if (s[--i] == e) return s + i;
+      return 0;
+    }
+
+  template <typename T>
+    inline const T* find_sequence(const T* s, size_t n, const T* p, size_t m)
+    {
+      if (m == 0 || m > n) return 0;
+      for (size_t i = 0; i <= n - m; ++i)
+        if (s[i] == p[0] && s[i + m - 1] == p[m - 1] && equal_elements(s + i + 1, p + 1, m - 1))
+          return s + i;
+      return 0;
+    }
+
+  template <typename T>
+    inline const T* find_last_sequence(const T* s, size_t n, const T* p, size_t m)
+    {
+      if (m == 0 || m > n) return 0;
+      for (size_t i = n - m + 1; i > 0;) {
+        --i;
+        if (s[i] == p[0] && s[i + m - 1] == p[m - 1] && equal_elements(s + i + 1, p + 1, m - 1))
+          return s + i;
+      }
+      return 0;
+    }
+
+#if defined(AUX_SSE2) || defined(AUX_NEON)
+
+  // SIMD lane traits: match() returns bit mask having LANE_BITS bits per lane equal
+  template <typename E> struct simd_lanes;
+
+#if defined(AUX_SSE2)
+  template <> struct simd_lanes<uint8_t>
+  {
+    typedef __m128i vec;
+    enum { LANES = 16, LANE_BITS = 1 };
+    static vec splat(uint8_t e)          { return _mm_set1_epi8(char(e)); }
+    static vec load(const uint8_t* p)    { return _mm_loadu_si128((const __m128i*)p); }
+    static uint64_t match(vec a, vec b)  { return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))); }
+    static uint64_t match(vec a, vec b, vec c, vec d)
+      { return unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(c, d)))); }
+  };
+  template <> struct simd_lanes<uint16_t>
+  {
+    typedef __m128i vec;
+    enum { LANES = 8, LANE_BITS = 2 };
+    static vec splat(uint16_t e)         { return _mm_set1_epi16(short(e)); }
+    static vec load(const uint16_t* p)   { return _mm_loadu_si128((const __m128i*)p); }
+    static uint64_t match(vec a, vec b)  { return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi16(a, b))); }
+    static uint64_t match(vec a, vec b, vec c, vec d)
+      { return unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, b), _mm_cmpeq_epi16(c, d)))); }
+  };
+#else
+  // NEON has no movemask, narrowing shift packs comparison result into 4 (bytes) or 8 (words) bits per lane
+  template <> struct simd_lanes<uint8_t>
+  {
+    typedef uint8x16_t vec;
+    enum { LANES = 16, LANE_BITS = 4 };
+    static vec splat(uint8_t e)          { return vdupq_n_u8(e); }
+    static vec load(const uint8_t* p)    { return vld1q_u8(p); }
+    static uint64_t mask(uint8x16_t r)   { return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(r), 4)), 0); }
+    static uint64_t match(vec a, vec b)  { return mask(vceqq_u8(a, b)); }
+    static uint64_t match(vec a, vec b, vec c, vec d) { return mask(vandq_u8(vceqq_u8(a, b), vceqq_u8(c, d))); }
+  };
+  template <> struct simd_lanes<uint16_t>
+  {
+    typedef uint16x8_t vec;
+    enum { LANES = 8, LANE_BITS = 8 };
+    static vec splat(uint16_t e)         { return vdupq_n_u16(e); }
+    static vec load(const uint16_t* p)   { return vld1q_u16(p); }
+    static uint64_t mask(uint16x8_t r)   { return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(r, 4)), 0); }
+    static uint64_t match(vec a, vec b)  { return mask(vceqq_u16(a, b)); }
+    static uint64_t match(vec a, vec b, vec c, vec d) { return mask(vandq_u16(vceqq_u16(a, b), vceqq_u16(c, d))); }
+  };
+#endif
+
+  template <typename E>
+    inline const E* simd_find_element(const E* s, size_t n, E e)
+    {
+      typedef simd_lanes<E> V;
+      typename V::vec ve = V::splat(e);
+      size_t i = 0;
+      for (; i + V::LANES <= n; i += V::LANES) {
+        uint64_t m = V::match(V::load(s + i), ve);
+        if (m) return s + i + lowest_bit(m) / V::LANE_BITS;
+      }
+      return find_element(s + i, n - i, e);
+    }
+
+  template <typename E>
+    inline const E* simd_find_last_element(const E* s, size_t n, E e)
+    {
+      typedef simd_lanes<E> V;
+      typename V::vec ve = V::splat(e);
+      size_t i = n;
+      for (; i >= V::LANES; ) {
+        i -= V::LANES;
+        uint64_t m = V::match(V::load(s + i), ve);
+        if (m) return s + i + highest_bit(m) / V::LANE_BITS;
+      }
+      return find_last_element(s, i, e);
+    }
+
+  // candidate positions are those where both first and last elements of the needle match
+  template <typename E>
+    inline const E* simd_find_sequence(const E* s, size_t n, const E* p, size_t m)
+    {
+      typedef simd_lanes<E> V;
+      if (m == 0 || m > n) return 0;
+      if (m == 1) return simd_find_element(s, n, p[0]);
+      typename V::vec vf = V::splat(p[0]);
+      typename V::vec vl = V::splat(p[m - 1]);
+      const uint64_t lane_mask = (uint64_t(1) << V::LANE_BITS) - 1;
+      size_t npos = n - m + 1; // number of candidate positions
+      size_t i = 0;
+      for (; i + V::LANES <= npos; i += V::LANES) {
+        uint64_t mask = V::match(V::load(s + i), vf, V::load(s + i + m - 1), vl);
+        while (mask) {
+          unsigned lane = lowest_bit(mask) / V::LANE_BITS;
+          if (equal_elements(s + i + lane + 1, p + 1, m - 2))
+            return s + i + lane;
+          mask &= ~(lane_mask << (lane * V::LANE_BITS));
+        }
+      }
+      const E* r = find_sequence(s + i, n - i, p, m);
+      return r;
+    }
+
+  template <typename E>
+    inline const E* simd_find_last_sequence(const E* s, size_t n, const E* p, size_t m)
+    {
+      typedef simd_lanes<E> V;
+      if (m == 0 || m > n) return 0;
+      if (m == 1) return simd_find_last_element(s, n, p[0]);
+      typename V::vec vf = V::splat(p[0]);
+      typename V::vec vl = V::splat(p[m - 1]);
+      const uint64_t lane_mask = (uint64_t(1) << V::LANE_BITS) - 1;
+      size_t npos = n - m + 1;
+      size_t i = npos;
+      for (; i >= V::LANES; ) {
+        i -= V::LANES;
+        uint64_t mask = V::match(V::load(s + i), vf, V::load(s + i + m - 1), vl);
+        while (mask) {
+          unsigned lane = highest_bit(mask) / V::LANE_BITS;
+          if (equal_elements(s + i + lane + 1, p + 1, m - 2))
+            return s + i + lane;
+          mask &= ~(lane_mask << (lane * V::LANE_BITS));
+        }
+      }
+      // positions [0..i) remain
+      return find_last_sequence(s, i + m - 1, p, m);
+    }
+
+#endif
+
+  // empty slices may have null start, memchr(0, e, 0) is undefined
+  inline const char* find_element(const char* s, size_t n, char e) { return n ? (const char*)memchr(s, e, n) : 0; }
+  inline const BYTE* find_element(const BYTE* s, size_t n, BYTE e) { return n ? (const BYTE*)memchr(s, e, n) : 0; }
+
+#if defined(AUX_SSE2) || defined(AUX_NEON)
+  inline const WCHAR* find_element(const WCHAR* s, size_t n, WCHAR e)
+    { return n ? (const WCHAR*)simd_find_element((const uint16_t*)s, n, uint16_t(e)) : 0; }
+
+  inline const char* find_last_element(const char* s, size_t n, char e)
+    { return (const char*)simd_find_last_element((const uint8_t*)s, n, uint8_t(e)); }
+  inline const BYTE* find_last_element(const BYTE* s, size_t n, BYTE e)
+    { return (const BYTE*)simd_find_last_element((const uint8_t*)s, n, uint8_t(e)); }
+  inline const WCHAR* find_last_element(const WCHAR* s, size_t n, WCHAR e)
+    { return (const WCHAR*)simd_find_last_element((const uint16_t*)s, n, uint16_t(e)); }
+
+  inline const char* find_sequence(const char* s, size_t n, const char* p, size_t m)
+    { return (const char*)simd_find_sequence((const uint8_t*)s, n, (const uint8_t*)p, m); }
+  inline const BYTE* find_sequence(const BYTE* s, size_t n, const BYTE* p, size_t m)
+    { return (const BYTE*)simd_find_sequence((const uint8_t*)s, n, (const uint8_t*)p, m); }
+  inline const WCHAR* find_sequence(const WCHAR* s, size_t n, const WCHAR* p, size_t m)
+    { return (const WCHAR*)simd_find_sequence((const uint16_t*)s, n, (const uint16_t*)p, m); }
+
+  inline const char* find_last_sequence(const char* s, size_t n, const char* p, size_t m)
+    { return (const char*)simd_find_last_sequence((const uint8_t*)s, n, (const uint8_t*)p, m); }
+  inline const BYTE* find_last_sequence(const BYTE* s, size_t n, const BYTE* p, size_t m)
+    { return (const BYTE*)simd_find_last_sequence((const uint8_t*)s, n, (const uint8_t*)p, m); }
+  inline const WCHAR* find_last_sequence(const WCHAR* s, size_t n, const WCHAR* p, size_t m)
+    { return (const WCHAR*)simd_find_last_sequence((const uint16_t*)s, n, (const uint16_t*)p, m); }
+#else
+  // no SIMD: memchr locates candidates for the first byte
+  inline const char* find_sequence(const char* s, size_t n, const char* p, size_t m)
+  {
+    if (m == 0 || m > n) return 0;
+    const char* last = s + n - m;
+    for (const char* c = s; c <= last; ++c) {
+      c = (const char*)memchr(c, p[0], last - c + 1);
+      if (!c) break;
+      if (memcmp(c + 1, p + 1, m - 1) == 0) return c;
+    }
+    return 0;
+  }
+  inline const BYTE* find_sequence(const BYTE* s, size_t n, const BYTE* p, size_t m)
+    { return (const BYTE*)find_sequence((const char*)s, n, (const char*)p, m); }
+#endif
+
 template <typename T >
    struct slice
    {
@@ -131,52 +400,26 @@ template <typename T >
 
       int index_of( T e ) const
       {
-        for( unsigned int i = 0; i < length; ++i ) if( start[i] == e ) return i;
-        return -1;
+        const T* p = find_element(start, length, e);
+        return p ? int(p - start) : -1;
       }
 
       int last_index_of( T e ) const
       {
-        for( size_t i = length; i > 0 ;) if( start[--i] == e ) return int(i);
-        return -1;
+        const T* p = find_last_element(start, length, e);
+        return p ? int(p - start) : -1;
       }
 
       int index_of( const slice& s ) const
       {
-        if( s.length > length ) return -1;
-        if( s.length == 0 ) return -1;
-        size_t l = length - s.length;
-        for( unsigned int i = 0; i < l ; ++i)
-          if( start[i] == *s.start )
-          {
-            const T* p = s.start;
-            size_t last = i + s.length;
-            for( unsigned int j = i + 1; j < last; ++j )
-              if( *(++p) != start[j])
-                goto next_i;
-            return i;
-            next_i: continue;
-          }
-        return -1;
+        const T* p = find_sequence(start, length, s.start, s.length);
+        return p ? int(p - start) : -1;
       }
 
       int last_index_of( const slice& s ) const
       {
-        if( s.length > length ) return -1;
-        if( s.length == 0 ) return -1;
-        const T* ps = s.end() - 1;
-        for( size_t i = length; i > 0 ; )
-          if( start[--i] == *ps )
-          {
-            const T* p = ps;
-            size_t j, first = i - s.length + 1;
-            for( j = i; j > first; )
-              if( *(--p) != start[--j])
-                goto next_i;
-            return int(j);
-            next_i: continue;
-          }
-        return -1;
+        const T* p = find_last_sequence(start, length, s.start, s.length);
+        return p ? int(p - start) : -1;
       }
 
       template <class Y>
@@ -267,6 +510,25 @@ template <typename T >
     assert( s1.index_of(s5) == -1 );
     assert( s1.last_index_of(s5) == -1 );
 
+    assert( s1.index_of(s1(7)) == 7 );
+    assert( s1.index_of(s1) == 0 );
+
+    const char* html = "<html><body>one <b>two</b> three <b>four</b></body></html>";
+    slice<char> c1(html, strlen(html));
+    assert( c1.index_of('b') == 7 );
+    assert( c1.last_index_of('>') == int(c1.length) - 1 );
+    assert( c1.index_of(slice<char>("<b>", 3)) == 16 );
+    assert( c1.last_index_of(slice<char>("<b>", 3)) == 33 );
+    assert( c1.index_of(slice<char>("</html>", 7)) == int(c1.length) - 7 );
+    assert( c1.index_of(slice<char>("<i>", 3)) == -1 );
+
+    const WCHAR* url = WSTR("this://app/resources/images/logo.png");
+    slice<WCHAR> w1(url, wcslen(url));
+    assert( w1.index_of(WCHAR('/')) == 5 );
+    assert( w1.last_index_of(WCHAR('/')) == 27 );
+    assert( w1.index_of(slice<WCHAR>(WSTR("images"), 6)) == 21 );
+    assert( w1.last_index_of(slice<WCHAR>(WSTR("://"), 3)) == 4 );
+
   }
 
   #endif
@@ -371,6 +633,281 @@ template <typename T >
   typedef tokens<char> atokens;
   typedef tokens<wchar_t> wtokens;
 
+#if defined(AUX_SSE2) || defined(AUX_NEON)
+  // first element equal to any of set[0..count), count is 1..4
+  template <typename E>
+    inline const E* simd_find_any(const E* s, size_t n, const unsigned* set, size_t count)
+    {
+      typedef simd_lanes<E> V;
+      typename V::vec v0 = V::splat(E(set[0]));
+      typename V::vec v1 = V::splat(E(set[count > 1 ? 1 : 0]));
+      typename V::vec v2 = V::splat(E(set[count > 2 ? 2 : 0]));
+      typename V::vec v3 = V::splat(E(set[count > 3 ? 3 : 0]));
+      size_t i = 0;
+      for (; i + V::LANES <= n; i += V::LANES) {
+        typename V::vec v = V::load(s + i);
+        uint64_t m = V::match(v, v0) | V::match(v, v1) | V::match(v, v2) | V::match(v, v3);
+        if (m) return s + i + lowest_bit(m) / V::LANE_BITS;
+      }
+      for (; i < n; ++i)
+        for (size_t k = 0; k < count; ++k)
+          if (s[i] == E(set[k])) return s + i;
+      return 0;
+    }
+#endif
+
+  // delimiters - set of delimiter chars for the tokenizers below.
+  // Chars below 256 live in inline 256-bit table, others - in pages of 256 bits
+  // allocated per high byte (two level table) so typical sets cost no heap allocations.
+  // find_in() scans by SIMD when set has up to 4 chars.
+
+  template <typename CT>
+    class delimiters
+    {
+      uint32_t              _low[8];      // chars 0..255
+      uint16_t              _pages[256];  // high byte -> 1-based page in _bits, 0 - no such chars
+      std::vector<uint32_t> _bits;        // pages, 8 words each
+      std::vector<unsigned> _wide;        // chars above 0xFFFF (UTF-32 wchar_t)
+      unsigned              _first[4];    // first chars added, for SIMD scanning
+      size_t                _count;
+
+      static unsigned code(CT c) { return sizeof(CT) == 1 ? unsigned((unsigned char)c) : unsigned(c); }
+
+    public:
+      delimiters() { clear(); }
+      delimiters(const CT* chars)  { clear(); for (; chars && *chars; ++chars) add(*chars); }
+      delimiters(slice<CT> chars)  { clear(); for (size_t n = 0; n < chars.length; ++n) add(chars.start[n]); }
+
+      void clear()
+      {
+        memset(_low, 0, sizeof(_low));
+        memset(_pages, 0, sizeof(_pages));
+        _bits.clear(); _wide.clear();
+        _count = 0;
+      }
+
+      void add(CT c)
+      {
+        if (contains(c)) return;
+        unsigned u = code(c);
+        if (_count < 4) _first[_count] = u;
+        ++_count;
+        if (u < 256)
+          _low[u >> 5] |= 1u << (u & 31);
+        else if (u <= 0xFFFF)
+        {
+          unsigned hi = u >> 8;
+          if (!_pages[hi])
+          {
+            _bits.resize(_bits.size() + 8, 0);
+            _pages[hi] = uint16_t(_bits.size() / 8);
+          }
+          unsigned lo = u & 0xFF;
+          _bits[(_pages[hi] - 1) * 8 + (lo >> 5)] |= 1u << (lo & 31);
+        }
+        else
+          _wide.push_back(u);
+      }
+
+      bool contains(CT c) const
+      {
+        unsigned u = code(c);
+        if (u < 256)
+          return (_low[u >> 5] & (1u << (u & 31))) != 0;
+        if (u <= 0xFFFF)
+        {
+          unsigned page = _pages[u >> 8];
+          if (!page) return false;
+          unsigned lo = u & 0xFF;
+          return (_bits[(page - 1) * 8 + (lo >> 5)] & (1u << (lo & 31))) != 0;
+        }
+        for (size_t n = 0; n < _wide.size(); ++n)
+          if (_wide[n] == u) return true;
+        return false;
+      }
+
+      size_t size() const { return _count; }
+
+      // first delimiter in [s..s+n) or NULL
+      const CT* find_in(const CT* s, size_t n) const
+      {
+        if (_count == 0) return 0;
+#if defined(AUX_SSE2) || defined(AUX_NEON)
+        if (_count <= 4)
+        {
+          if (sizeof(CT) == 1)
+            return (const CT*)simd_find_any((const uint8_t*)s, n, _first, _count);
+          if (sizeof(CT) == 2)
+            return (const CT*)simd_find_any((const uint16_t*)s, n, _first, _count);
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+          if (contains(s[i])) return s + i;
+        return 0;
+      }
+    };
+
+  // token_iterator - input iterator over tokenizer S producing values V,
+  // to support for(auto token : tokenizer) {} loops
+  template <class S, typename V>
+    class token_iterator
+    {
+      S*  _s;
+      V   _v;
+    public:
+      explicit token_iterator(S* s = 0): _s(s) { if (_s && !_s->next(_v)) _s = 0; }
+      const V& operator*() const  { return _v; }
+      const V* operator->() const { return &_v; }
+      token_iterator& operator++() { if (!_s->next(_v)) _s = 0; return *this; }
+      bool operator == (const token_iterator& r) const { return _s == r._s; }
+      bool operator != (const token_iterator& r) const { return _s != r._s; }
+    };
+
+  // splitter - splits text by any of delimiter chars or by multi-char separator.
+  // N delimiters in the text give N+1 tokens (empty ones included), empty text gives no tokens.
+  // Tokens are slices of the text - no allocations.
+  //   for( aux::chars field : aux::splitter<char>(line, ",;") ) ...
+  //   for( aux::chars line : aux::splitter<char>(text, aux::chars("\r\n",2)) ) ...
+
+  template <typename CT>
+    class splitter
+    {
+      delimiters<CT> _delims;
+      slice<CT>      _separator; // used if not empty
+      const CT*      _p;
+      const CT*      _end;
+      bool           _done;
+
+    public:
+      typedef token_iterator<splitter, slice<CT> > iterator;
+
+      splitter(slice<CT> text, const CT* delimiter_chars)
+        : _delims(delimiter_chars), _p(text.start), _end(text.end()), _done(text.length == 0) {}
+      splitter(slice<CT> text, const delimiters<CT>& delims)
+        : _delims(delims), _p(text.start), _end(text.end()), _done(text.length == 0) {}
+      splitter(slice<CT> text, slice<CT> separator)
+        : _separator(separator), _p(text.start), _end(text.end()), _done(text.length == 0) {}
+
+      bool next(slice<CT>& token)
+      {
+        if (_done) return false;
+        size_t n = size_t(_end - _p);
+        const CT* d = _separator.length ? find_sequence(_p, n, _separator.start, _separator.length)
+                                        : _delims.find_in(_p, n);
+        if (!d)
+        {
+          token = slice<CT>(_p, n);
+          _p = _end;
+          _done = true;
+          return true;
+        }
+        token = slice<CT>(_p, size_t(d - _p));
+        _p = d + (_separator.length ? _separator.length : 1);
+        return true;
+      }
+
+      iterator begin() { return iterator(this); }
+      iterator end()   { return iterator(); }
+    };
+
+  // field of delimited (CSV, TSV) text
+  template <typename CT>
+    struct field
+    {
+      slice<CT> text;    // content without enclosing quotes, doubled quotes inside are kept - see unquote()
+      bool      quoted;  // was enclosed in quotes
+      bool      last;    // last field in the row
+      field(): quoted(false), last(false) {}
+    };
+
+  // field_splitter - splits delimited text into fields and rows:
+  // fields are separated by delimiter chars, rows - by "\n" or "\r\n",
+  // fields enclosed in quote chars may contain delimiters, line breaks and doubled quotes.
+  //   aux::field_splitter<char> csv(text, ",");
+  //   for( const aux::field<char>& f : csv ) { ...; if(f.last) /*end of row*/; }
+
+  template <typename CT>
+    class field_splitter
+    {
+      delimiters<CT> _delims; // field delimiters + '\n'
+      CT             _quote;
+      const CT*      _p;
+      const CT*      _end;
+      bool           _pending; // previous field ended by delimiter - there is one more field
+
+    public:
+      typedef token_iterator<field_splitter, field<CT> > iterator;
+
+      field_splitter(slice<CT> text, const CT* delimiter_chars, CT quote = CT('"'))
+        : _delims(delimiter_chars), _quote(quote), _p(text.start), _end(text.end()), _pending(false)
+      {
+        _delims.add(CT('\n'));
+      }
+
+      bool next(field<CT>& f)
+      {
+        if (_p >= _end)
+        {
+          if (!_pending) return false;
+          _pending = false;
+          f.text = slice<CT>(_end, 0); f.quoted = false; f.last = true;
+          return true;
+        }
+        f.quoted = false;
+        const CT* s = _p;
+        const CT* e = 0;
+        if (*_p == _quote)
+        {
+          // quoted field, "" inside is an escaped quote
+          const CT* q = _p + 1;
+          for (;;)
+          {
+            q = find_element(q, size_t(_end - q), _quote);
+            if (!q || q + 1 >= _end || q[1] != _quote) break;
+            q += 2;
+          }
+          f.quoted = true;
+          s = _p + 1;
+          e = q ? q : _end;
+          _p = q ? q + 1 : _end;
+        }
+        const CT* d = _delims.find_in(_p, size_t(_end - _p));
+        if (!f.quoted) e = d ? d : _end; // text after closing quote is ignored
+        if (!d)
+        {
+          f.last = true;
+          _p = _end;
+          _pending = false;
+        }
+        else
+        {
+          f.last = *d == CT('\n');
+          if (f.last && !f.quoted && e > s && e[-1] == CT('\r')) --e;
+          _p = d + 1;
+          _pending = !f.last;
+        }
+        f.text = slice<CT>(s, size_t(e - s));
+        return true;
+      }
+
+      iterator begin() { return iterator(this); }
+      iterator end()   { return iterator(); }
+    };
+
+  // collapses doubled quotes of quoted field text into dst (at least text.length elements),
+  // returns number of elements written
+  template <typename CT>
+    inline size_t unquote(slice<CT> text, CT* dst, CT quote = CT('"'))
+    {
+      size_t n = 0;
+      for (size_t i = 0; i < text.length; ++i)
+      {
+        dst[n++] = text.start[i];
+        if (text.start[i] == quote && i + 1 < text.length && text.start[i + 1] == quote) ++i;
+      }
+      return n;
+    }
+
 
     /****************************************************************************/
     //
@@ -499,19 +1036,574 @@ template <typename T >
       return -1;
     }
 
+  // compiled_pattern - the same wildcards as match() above: '*', '?', '#' (digit) and [...] char sets,
+  // parsed once. Pattern is split by '*' into segments of fixed width, the first one
+  // is checked as prefix, the last one as suffix and the rest are located left to right by
+  // the first fit - that is exact for wildcard patterns so the matcher never backtracks.
+  // Literal segments are searched by find_sequence(). Intended to be built once, e.g.:
+  //   static const aux::compiled_pattern<WCHAR> res_uri(WSTR("res:*"));
+  //   if( res_uri.match(uri) ) ...
+
+  template <typename CT>
+    class compiled_pattern
+    {
+    public:
+      enum ATOM_TYPE { LITERAL, ANY_CHAR, ANY_DIGIT, CHAR_SET };
+
+      struct atom
+      {
+        ATOM_TYPE type;
+        CT        c;    // LITERAL: the char
+        size_t    set;  // CHAR_SET: index in _sets
+      };
+
+    protected:
+      // char set as list of ranges, instead of 2^(sizeof(CT)*8) bitmap
+      struct char_set
+      {
+        bool inverse;
+        std::vector< std::pair<CT,CT> > ranges;
+
+        bool valid(CT c) const
+        {
+          for (size_t n = 0; n < ranges.size(); ++n)
+            if (c >= ranges[n].first && c <= ranges[n].second)
+              return !inverse;
+          return inverse;
+        }
+      };
+
+      struct segment
+      {
+        size_t  first;   // index of the first atom
+        size_t  length;  // number of atoms
+        bool    literal; // all atoms are LITERALs
+      };
+
+      std::vector<atom>          _atoms;
+      std::vector<CT>            _literals; // LITERAL chars, parallel to _atoms
+      std::vector<segment>       _segments;
+      std::vector<char_set>      _sets;
+      bool                       _star_at_start;
+      bool                       _star_at_end;
+
+      void parse_set(const CT* &p)
+      {
+        char_set cs;
+        cs.inverse = *p == '^';
+        if (cs.inverse) ++p;
+        if (*p == '-') { cs.ranges.push_back(std::make_pair(CT('-'), CT('-'))); ++p; }
+        while (*p)
+        {
+          if (p[0] == ']') { ++p; break; }
+          if (p[1] == '-' && p[2] != 0 && p[2] != ']') { cs.ranges.push_back(std::make_pair(p[0], p[2])); p += 3; }
+          else { cs.ranges.push_back(std::make_pair(p[0], p[0])); ++p; }
+        }
+        _sets.push_back(cs);
+      }
+
+      bool match_atom(const atom& a, CT c) const
+      {
+        switch (a.type)
+        {
+          case LITERAL:   return a.c == c;
+          case ANY_CHAR:  return true;
+          case ANY_DIGIT: return c >= '0' && c <= '9';
+          case CHAR_SET:  return _sets[a.set].valid(c);
+        }
+        return false;
+      }
+
+      bool match_segment(const segment& sg, const CT* s) const
+      {
+        if (sg.literal)
+          return equal_elements(s, &_literals[sg.first], sg.length);
+        for (size_t n = 0; n < sg.length; ++n)
+          if (!match_atom(_atoms[sg.first + n], s[n]))
+            return false;
+        return true;
+      }
+
+      // leftmost position of the segment in [s..s+n) or NULL
+      const CT* find_segment(const segment& sg, const CT* s, size_t n) const
+      {
+        if (sg.length > n) return 0;
+        if (sg.literal)
+          return find_sequence(s, n, &_literals[sg.first], sg.length);
+        const CT* last = s + n - sg.length;
+        const atom& a0 = _atoms[sg.first];
+        for (const CT* p = s; p <= last; ++p)
+        {
+          if (a0.type == LITERAL)
+          {
+            p = find_element(p, size_t(last - p) + 1, a0.c);
+            if (!p) return 0;
+          }
+          if (match_segment(sg, p))
+            return p;
+        }
+        return 0;
+      }
+
+    public:
+      compiled_pattern(): _star_at_start(false), _star_at_end(false) {}
+      explicit compiled_pattern(const CT* pattern) { compile(pattern); }
+
+      void compile(const CT* pattern)
+      {
+        _atoms.clear(); _literals.clear(); _segments.clear(); _sets.clear();
+        _star_at_start = _star_at_end = false;
+        static const CT empty[1] = { 0 };
+        const CT* p = pattern ? pattern : empty;
+        segment sg = { 0, 0, true };
+        bool star = false;
+        while (*p)
+        {
+          if (*p == '*')
+          {
+            while (*p == '*') ++p;
+            if (_atoms.empty() && _segments.empty()) _star_at_start = true;
+            if (sg.length) { _segments.push_back(sg); }
+            sg.first = _atoms.size(); sg.length = 0; sg.literal = true;
+            star = true;
+            continue;
+          }
+          atom a = { LITERAL, 0, 0 };
+          if (*p == '?')      { a.type = ANY_CHAR; ++p; }
+          else if (*p == '#') { a.type = ANY_DIGIT; ++p; }
+          else if (*p == '[') { ++p; parse_set(p); a.type = CHAR_SET; a.set = _sets.size() - 1; }
+          else                { a.c = *p++; }
+          if (a.type != LITERAL) sg.literal = false;
+          _atoms.push_back(a);
+          _literals.push_back(a.c);
+          ++sg.length;
+          star = false;
+        }
+        if (sg.length) _segments.push_back(sg);
+        _star_at_end = star;
+      }
+
+      // true if whole text matches the pattern
+      bool match(slice<CT> text) const
+      {
+        const CT* s = text.start;
+        const CT* e = text.end();
+        size_t first = 0, last = _segments.size();
+
+        if (last == 0) // empty pattern or stars only
+          return _star_at_start || text.length == 0;
+
+        if (!_star_at_start)
+        {
+          const segment& sg = _segments[0];
+          if (size_t(e - s) < sg.length || !match_segment(sg, s)) return false;
+          s += sg.length;
+          ++first;
+          if (last == 1 && !_star_at_end) return s == e; // no stars at all
+        }
+        if (!_star_at_end && first < last)
+        {
+          const segment& sg = _segments[last - 1];
+          if (size_t(e - s) < sg.length || !match_segment(sg, e - sg.length)) return false;
+          e -= sg.length;
+          --last;
+        }
+        for (size_t n = first; n < last; ++n)
+        {
+          const segment& sg = _segments[n];
+          const CT* p = find_segment(sg, s, size_t(e - s));
+          if (!p) return false;
+          s = p + sg.length;
+        }
+        return true;
+      }
+
+      bool operator()(slice<CT> text) const { return match(text); }
+
+      // leading literal chars of the pattern - the prefix every matching text starts with
+      slice<CT> literal_prefix() const
+      {
+        if (_star_at_start || _segments.empty()) return slice<CT>();
+        const segment& sg = _segments[0];
+        size_t n = 0;
+        while (n < sg.length && _atoms[n].type == LITERAL) ++n;
+        return slice<CT>(_literals.empty() ? 0 : &_literals[0], n);
+      }
+    };
+
+  // pattern_set - list of compiled patterns matched in single pass over the text:
+  // literal prefixes of the patterns form a trie, walking the text through it yields
+  // candidates, only candidates get their wildcard tails checked.
+  // match() returns index of the first pattern (in order of addition) matching the text, or -1
+
+  template <typename CT>
+    class pattern_set
+    {
+      struct node
+      {
+        std::vector< std::pair<CT,size_t> > children; // sorted by char
+        std::vector<size_t>                 patterns; // patterns having prefix ending here
+      };
+      std::vector< compiled_pattern<CT> > _patterns;
+      std::vector<node>                   _nodes;
+
+      size_t child(size_t n, CT c) const
+      {
+        const std::vector< std::pair<CT,size_t> >& ch = _nodes[n].children;
+        size_t lo = 0, hi = ch.size();
+        while (lo < hi)
+        {
+          size_t mid = (lo + hi) / 2;
+          if (ch[mid].first < c) lo = mid + 1; else hi = mid;
+        }
+        return (lo < ch.size() && ch[lo].first == c) ? ch[lo].second : 0;
+      }
+
+    public:
+      pattern_set(): _nodes(1) {}
+      template <size_t N>
+        explicit pattern_set(const CT* const (&patterns)[N]): _nodes(1)
+        {
+          for (size_t n = 0; n < N; ++n) add(patterns[n]);
+        }
+
+      // returns index of the pattern
+      size_t add(const CT* pattern)
+      {
+        size_t idx = _patterns.size();
+        _patterns.push_back(compiled_pattern<CT>(pattern));
+        slice<CT> prefix = _patterns.back().literal_prefix();
+        size_t n = 0;
+        for (size_t i = 0; i < prefix.length; ++i)
+        {
+          CT c = prefix.start[i];
+          size_t next = child(n, c);
+          if (!next)
+          {
+            next = _nodes.size();
+            _nodes.push_back(node());
+            std::vector< std::pair<CT,size_t> >& ch = _nodes[n].children;
+            typename std::vector< std::pair<CT,size_t> >::iterator it = ch.begin();
+            while (it != ch.end() && it->first < c) ++it;
+            ch.insert(it, std::make_pair(c, next));
+          }
+          n = next;
+        }
+        _nodes[n].patterns.push_back(idx);
+        return idx;
+      }
+
+      size_t size() const { return _patterns.size(); }
+      const compiled_pattern<CT>& operator[](size_t idx) const { return _patterns[idx]; }
+
+      int match(slice<CT> text) const
+      {
+        size_t best = _patterns.size();
+        size_t n = 0;
+        for (size_t i = 0;; ++i)
+        {
+          const std::vector<size_t>& candidates = _nodes[n].patterns;
+          for (size_t k = 0; k < candidates.size(); ++k)
+            if (candidates[k] < best && _patterns[candidates[k]].match(text))
+              best = candidates[k];
+          if (i == text.length) break;
+          n = child(n, text.start[i]);
+          if (!n) break;
+        }
+        return best < _patterns.size() ? int(best) : -1;
+      }
+    };
+
   template <typename T >
     inline bool slice<T>::like ( const T *pattern ) const
     {
       return match<T>(*this,pattern) >= 0;
     }
 
+  // numeric parsing and formatting, from_chars/to_chars style:
+  //   parse_uint(), parse_int(), parse_double() - parse number at the start of the text,
+  //     return number of chars consumed, 0 - no number there. Integers saturate on overflow.
+  //   format_uint(), format_int(), format_double() - write zero terminated number, return its length.
+  // No locale is involved: '.' is the decimal point everywhere.
+
+  // value of digit c in bases up to 36, 255 - not a digit
+  template <typename T>
+    inline unsigned digit_value(T c)
+    {
+      unsigned u = sizeof(T) == 1 ? unsigned((unsigned char)c) : unsigned(c);
+      if (u - '0' < 10) return u - '0';
+      if (u - 'a' < 26) return u - 'a' + 10;
+      if (u - 'A' < 26) return u - 'A' + 10;
+      return 255;
+    }
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  #define AUX_SWAR_DIGITS
+  // SWAR: eight ASCII digits loaded as little endian 64-bit word
+  inline bool is_eight_digits(uint64_t v)
+  {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) |
+           (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+  }
+  inline uint32_t eight_digits_value(uint64_t v)
+  {
+    const uint64_t mask = 0x000000FF000000FFull;
+    const uint64_t mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return uint32_t(v);
+  }
+#endif
+
+  // decimal digits at p, accumulated into w while it has room, SWAR for char strings
+  template <typename T>
+    inline const T* scan_decimal(const T* p, const T* e, uint64_t& w, bool& overflow)
+    {
+#if defined(AUX_SWAR_DIGITS)
+      if (sizeof(T) == 1)
+        while (e - p >= 8 && w <= 184467440736ull) // w * 10^8 + 99999999 fits
+        {
+          uint64_t c; memcpy(&c, p, 8);
+          if (!is_eight_digits(c)) break;
+          w = w * 100000000ull + eight_digits_value(c);
+          p += 8;
+        }
+#endif
+      for (; p < e; ++p)
+      {
+        unsigned d = unsigned(*p) - '0';
+        if (d > 9) break;
+        if (w > (UINT64_MAX - d) / 10) { overflow = true; w = UINT64_MAX; }
+        else w = w * 10 + d;
+      }
+      return p;
+    }
+
+  template <typename T>
+    inline size_t parse_uint(slice<T> text, uint64_t& v, unsigned base = 10)
+    {
+      const T* p = text.start;
+      const T* e = text.end();
+      uint64_t w = 0;
+      bool overflow = false;
+      if (base == 10)
+        p = scan_decimal(p, e, w, overflow);
+      else if (base >= 2 && base <= 36)
+        for (; p < e; ++p)
+        {
+          unsigned d = digit_value(*p);
+          if (d >= base) break;
+          if (w > (UINT64_MAX - d) / base) { overflow = true; w = UINT64_MAX; }
+          else w = w * base + d;
+        }
+      if (p == text.start) return 0;
+      v = w;
+      return size_t(p - text.start);
+    }
+
+  template <typename T>
+    inline size_t parse_int(slice<T> text, int64_t& v, unsigned base = 10)
+    {
+      bool neg = text.length && text.start[0] == '-';
+      size_t sign = (text.length && (text.start[0] == '-' || text.start[0] == '+')) ? 1 : 0;
+      text.prune(sign);
+      uint64_t u;
+      size_t n = parse_uint(text, u, base);
+      if (!n) return 0;
+      if (neg) v = u >= uint64_t(INT64_MAX) + 1 ? INT64_MIN : -int64_t(u);
+      else v = u > uint64_t(INT64_MAX) ? INT64_MAX : int64_t(u);
+      return sign + n;
+    }
+
+  // C locale for the CRT fallback of parse_double()
+#if defined(WINDOWS)
+  inline _locale_t c_numeric_locale() { static _locale_t loc = _create_locale(LC_NUMERIC, "C"); return loc; }
+  inline double c_strtod(const char* s, char** end) { return _strtod_l(s, end, c_numeric_locale()); }
+#else
+  inline locale_t c_numeric_locale() { static locale_t loc = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0); return loc; }
+  inline double c_strtod(const char* s, char** end) { return strtod_l(s, end, c_numeric_locale()); }
+#endif
+
+  // true if text starts with ASCII word w, case insensitive
+  template <typename T>
+    inline bool starts_with_word(const T* p, const T* e, const char* w)
+    {
+      for (; *w; ++w, ++p)
+        if (p >= e || (unsigned(*p) | 0x20) != unsigned(*w)) return false;
+      return true;
+    }
+
+  // Decimal floating point number: [+-]digits[.digits][(e|E)[+-]digits], "inf", "infinity", "nan".
+  // Up to 19 significant digits with |exponent| <= 22 are converted exactly by Clinger's fast path,
+  // longer or out of range numbers go to the C-locale strtod for correct rounding.
+  template <typename T>
+    inline size_t parse_double(slice<T> text, double& v)
+    {
+      static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+      const T* p = text.start;
+      const T* e = text.end();
+      bool neg = false;
+      if (p < e && (*p == '-' || *p == '+')) { neg = *p == '-'; ++p; }
+
+      if (p < e && (*p == 'i' || *p == 'I' || *p == 'n' || *p == 'N'))
+      {
+        if (starts_with_word(p, e, "infinity")) { v = neg ? -HUGE_VAL : HUGE_VAL; return size_t(p + 8 - text.start); }
+        if (starts_with_word(p, e, "inf")) { v = neg ? -HUGE_VAL : HUGE_VAL; return size_t(p + 3 - text.start); }
+        if (starts_with_word(p, e, "nan")) { v = neg ? -NAN : NAN; return size_t(p + 3 - text.start); }
+        return 0;
+      }
+
+      uint64_t w = 0;      // significant digits
+      int      ndigits = 0;
+      int      e10 = 0;
+      bool     inexact = false; // digits dropped or exponent overflown
+      const T* digits = p;
+
+      while (p < e && *p == '0') ++p; // leading zeros
+      const T* int_digits = p;
+      bool overflow = false;
+      p = scan_decimal(p, e, w, overflow);
+      ndigits = int(p - int_digits);
+      if (overflow || ndigits > 19) inexact = true;
+      if (p < e && *p == '.')
+      {
+        ++p;
+        const T* frac = p;
+        if (w == 0)
+          for (; p < e && *p == '0'; ++p) --e10; // zeros after point
+        for (; p < e && unsigned(*p) - '0' < 10; ++p)
+          if (ndigits < 19) { w = w * 10 + (*p - '0'); ++ndigits; --e10; }
+          else if (*p != '0') inexact = true;
+        if (p == frac && frac - 1 == digits) return 0; // lone "."
+      }
+      if (p == digits) return 0;
+
+      if (p < e && (*p == 'e' || *p == 'E'))
+      {
+        const T* q = p + 1;
+        bool eneg = false;
+        if (q < e && (*q == '-' || *q == '+')) { eneg = *q == '-'; ++q; }
+        if (q < e && unsigned(*q) - '0' < 10)
+        {
+          int x = 0;
+          for (; q < e && unsigned(*q) - '0' < 10; ++q)
+            if (x < 100000) x = x * 10 + (*q - '0');
+          e10 += eneg ? -x : x;
+          p = q;
+        }
+      }
+
+      size_t consumed = size_t(p - text.start);
+      if (w == 0)
+      {
+        v = neg ? -0.0 : 0.0;
+        return consumed;
+      }
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+      if (!inexact && w <= (uint64_t(1) << 53) && e10 >= -22 && e10 <= 22)
+      {
+        double d = double(w);
+        d = e10 < 0 ? d / pow10[-e10] : d * pow10[e10];
+        v = neg ? -d : d;
+        return consumed;
+      }
+#endif
+      // correctly rounded conversion by CRT in C locale
+      char local[64];
+      std::vector<char> big;
+      char* buf = local;
+      if (consumed >= sizeof(local)) { big.resize(consumed + 1); buf = &big[0]; }
+      for (size_t i = 0; i < consumed; ++i) buf[i] = char(text.start[i]);
+      buf[consumed] = 0;
+      char* end = 0;
+      v = c_strtod(buf, &end);
+      return consumed;
+    }
+
+  template <typename CT>
+    inline size_t format_uint(CT* buf, uint64_t v, unsigned radix = 10) // buf: 65 elements at least
+    {
+      static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+      static const char num[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+      CT tmp[64];
+      CT* p = tmp + 64;
+      if (radix < 2 || radix > 36) { buf[0] = 0; return 0; }
+      if (radix == 10)
+      {
+        while (v >= 100)
+        {
+          unsigned i = unsigned(v % 100) * 2;
+          v /= 100;
+          *--p = CT(pairs[i + 1]);
+          *--p = CT(pairs[i]);
+        }
+        if (v >= 10) { unsigned i = unsigned(v) * 2; *--p = CT(pairs[i + 1]); *--p = CT(pairs[i]); }
+        else *--p = CT('0' + unsigned(v));
+      }
+      else
+        do { *--p = CT(num[v % radix]); v /= radix; } while (v);
+      size_t n = size_t(tmp + 64 - p);
+      for (size_t i = 0; i < n; ++i) buf[i] = p[i];
+      buf[n] = 0;
+      return n;
+    }
+
+  template <typename CT>
+    inline size_t format_int(CT* buf, int64_t v, unsigned radix = 10) // buf: 66 elements at least
+    {
+      if (v < 0)
+      {
+        *buf = CT('-');
+        return 1 + format_uint(buf + 1, uint64_t(0) - uint64_t(v), radix);
+      }
+      return format_uint(buf, uint64_t(v), radix);
+    }
+
+  // shortest representation that reads back to the same double
+  template <typename CT>
+    inline size_t format_double(CT* buf, double v) // buf: 32 elements at least
+    {
+      char tmp[32];
+      size_t n = 0;
+      if (v != v) { memcpy(tmp, "nan", 4); n = 3; }
+      else if (v == HUGE_VAL) { memcpy(tmp, "inf", 4); n = 3; }
+      else if (v == -HUGE_VAL) { memcpy(tmp, "-inf", 5); n = 4; }
+      else
+      {
+#if defined(AUX_TO_CHARS_DOUBLE)
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp) - 1, v);
+        n = size_t(r.ptr - tmp);
+#else
+        for (int precision = 15; precision <= 17; ++precision)
+        {
+          n = size_t(snprintf(tmp, sizeof(tmp), "%.*g", precision, v));
+          // CRT is locale dependent, fix decimal point
+          for (size_t i = 0; i < n; ++i)
+            if (tmp[i] == ',') tmp[i] = '.';
+          double back = 0;
+          if (parse_double(slice<char>(tmp, n), back) == n && back == v) break;
+        }
+#endif
+      }
+      for (size_t i = 0; i < n; ++i) buf[i] = CT(tmp[i]);
+      buf[n] = 0;
+      return n;
+    }
+
   // chars to unsigned int
   // chars to int
+  // chars to double
+  // on return span.length is number of chars consumed
 
   template <typename T>
       inline unsigned int to_uint(slice<T>& span, unsigned int base = 10)
   {
-     unsigned int result = 0,value;
      const T *cp = span.start;
      const T *pend = span.end();
 
@@ -520,10 +1612,10 @@ template <typename T >
      if (!base)
      {
          base = 10;
-         if (*cp == '0') {
+         if (cp < pend && *cp == '0') {
              base = 8;
              cp++;
-             if ((toupper(*cp) == 'X') && is_xdigit(cp[1])) {
+             if (cp + 1 < pend && (*cp == 'x' || *cp == 'X') && digit_value(cp[1]) < 16) {
                      cp++;
                      base = 16;
              }
@@ -531,16 +1623,13 @@ template <typename T >
      }
      else if (base == 16)
      {
-         if (cp[0] == '0' && toupper(cp[1]) == 'X')
+         if (cp + 1 < pend && cp[0] == '0' && (cp[1] == 'x' || cp[1] == 'X'))
              cp += 2;
      }
-     while ( cp < pend && is_xdigit(*cp) &&
-            (value = is_digit(*cp) ? *cp-'0' : toupper(*cp)-'A'+10) < base) {
-             result = result*base + value;
-             cp++;
-     }
+     uint64_t result = 0;
+     cp += parse_uint(slice<T>(cp, size_t(pend - cp)), result, base);
      span.length = (unsigned int)(cp - span.start);
-     return result;
+     return result > UINT_MAX ? UINT_MAX : (unsigned int)result;
   }
 
   template <typename T>
@@ -548,12 +1637,21 @@ template <typename T >
   {
 
      while (span.length > 0 && is_space(span[0]) ) { ++span.start; --span.length; }
-     if(span[0] == '-')
+     if(span.length && span[0] == '-')
      {
         ++span.start; --span.length;
-        return - int(to_uint(span,base));
+        return int(-int64_t(to_uint(span,base)));
      }
-     return to_uint(span,base);
+     return int(to_uint(span,base));
+  }
+
+  template <typename T>
+      double to_double(slice<T>& span, double default_value = 0)
+  {
+     while (span.length > 0 && is_space(span[0]) ) { ++span.start; --span.length; }
+     double v = default_value;
+     span.length = parse_double(span, v);
+     return v;
   }
 
 }
@@ -45,15 +45,17 @@
 
 #ifdef __cplusplus
   #include <cstddef>
+  #include <vector>
+  #include <algorithm>
 #endif
 
 struct AzuriteGraphicsAPI;
 struct AZURITE_X_MSG;
 
 #ifdef WINDOWLESS
-  #define AZURITE_API_VERSION 0x10009
+  #define AZURITE_API_VERSION 0x1000F
 #else 
-  #define AZURITE_API_VERSION 9
+  #define AZURITE_API_VERSION 15
 #endif
 
 typedef struct _IAzuriteAPI {
@@ -307,6 +309,30 @@ typedef struct _IAzuriteAPI {
 
   SBOOL   SCFN(AzuriteReleaseGlobalAsset)(som_asset_t* pass);
 
+  // API_VERSION 10
+  UINT SCFN( ValueArraySetRange )( VALUE* pval, INT first, UINT n, const VALUE* pvals);
+  UINT SCFN( ValueMapSetItems )( VALUE* pval, UINT n, const VALUE* pkeyvals);
+  UINT SCFN( ValueReserve )( VALUE* pval, UINT capacity);
+
+  // API_VERSION 11
+  UINT SCFN( ValueBinaryDataSetExternal )( VALUE* pval, BYTE* pBytes, UINT nBytes, UINT units, NATIVE_FUNCTOR_RELEASE* prelease, VOID* tag);
+
+  // API_VERSION 12
+  UINT SCFN( ValueGetValueOfPath )( const VALUE* pval, UINT n, const VALUE* pkeys, VALUE* pretval);
+
+  // API_VERSION 13
+  SCDOM_RESULT SCFN( AzuriteCompileSelector )( LPCSTR CSS_selectors, HSELECTOR* phs);
+  SCDOM_RESULT SCFN( AzuriteReleaseSelector )( HSELECTOR hs);
+  SCDOM_RESULT SCFN( AzuriteSelectElementsCompiled )( HELEMENT he, HSELECTOR hs, AzuriteElementCallback* callback, LPVOID param);
+  SCDOM_RESULT SCFN( AzuriteSelectParentCompiled )( HELEMENT he, HSELECTOR hs, UINT depth, HELEMENT* heFound);
+
+  // API_VERSION 14
+  SCDOM_RESULT SCFN( AzuriteApplyMutations )( const DOM_MUTATION* mutations, UINT n, SBOOL andForceRender);
+
+  // API_VERSION 15
+  SCDOM_RESULT SCFN( AzuriteGetChildren )( HELEMENT he, HELEMENT* children, UINT capacity, UINT* p_count, SBOOL use);
+  SCDOM_RESULT SCFN( AzuriteEnumAttributes )( HELEMENT he, ATTRIBUTE_RECEIVER* rcv, LPVOID rcv_param);
+
 } IAzuriteAPI;
 
 typedef IAzuriteAPI* (SCAPI *AzuriteAPI_ptr)();
@@ -535,6 +561,12 @@ inline IAzuriteAPI *_SAPI(IAzuriteAPI *ext) {
     return SAPI()->GetAzuriteRequestAPI();
   }
 
+  // API_VERSION of loaded engine, functions added after it are not in its IAzuriteAPI table
+  inline UINT sapi_version()
+  {
+    return SAPI()->version & 0xFFFF;
+  }
+
 
   // defining "official" API functions:
 
@@ -708,6 +740,228 @@ inline IAzuriteAPI *_SAPI(IAzuriteAPI *ext) {
   inline UINT SCAPI ValueNativeFunctorSet (VALUE* pval, NATIVE_FUNCTOR_INVOKE*  pinvoke, NATIVE_FUNCTOR_RELEASE* prelease, VOID* tag ) { return SAPI()->ValueNativeFunctorSet ( pval, pinvoke,prelease,tag); }
   inline SBOOL SCAPI ValueIsNativeFunctor ( const VALUE* pval) { return SAPI()->ValueIsNativeFunctor (pval); }
 
+  // API_VERSION 10 functions, emulated on older engines
+
+  inline UINT SCAPI ValueArraySetRange ( VALUE* pval, INT first, UINT n, const VALUE* pvals)
+  {
+    IAzuriteAPI* api = SAPI();
+    if( sapi_version() >= 10 )
+      return api->ValueArraySetRange(pval, first, n, pvals);
+    if( first < 0 ) return HV_BAD_PARAMETER;
+    UINT t = 0, u = 0;
+    api->ValueType(pval, &t, &u);
+    if( t != T_ARRAY && !(t == T_OBJECT && u == UT_OBJECT_ARRAY) ) {
+      api->ValueClear(pval);
+      api->ValueIntDataSet(pval, first + INT(n), T_ARRAY, 0); // preallocated
+    }
+    else if( n ) {
+      INT length = 0;
+      api->ValueElementsCount(pval, &length);
+      if( length < first + INT(n) ) // set last one first so the array grows once
+        api->ValueNthElementValueSet(pval, first + INT(n) - 1, pvals + n - 1);
+    }
+    for( UINT i = 0; i < n; ++i ) {
+      UINT r = api->ValueNthElementValueSet(pval, first + INT(i), pvals + i);
+      if( r != HV_OK ) return r;
+    }
+    return HV_OK;
+  }
+
+  inline UINT SCAPI ValueMapSetItems ( VALUE* pval, UINT n, const VALUE* pkeyvals)
+  {
+    IAzuriteAPI* api = SAPI();
+    if( sapi_version() >= 10 )
+      return api->ValueMapSetItems(pval, n, pkeyvals);
+    UINT t = 0, u = 0;
+    api->ValueType(pval, &t, &u);
+    if( t != T_MAP && t != T_OBJECT ) {
+      api->ValueClear(pval);
+      api->ValueIntDataSet(pval, 0, T_MAP, 0);
+    }
+    for( UINT i = 0; i < n; ++i ) {
+      UINT r = api->ValueSetValueToKey(pval, pkeyvals + i * 2, pkeyvals + i * 2 + 1);
+      if( r != HV_OK ) return r;
+    }
+    return HV_OK;
+  }
+
+  inline UINT SCAPI ValueReserve ( VALUE* pval, UINT capacity)
+  {
+    if( sapi_version() >= 10 )
+      return SAPI()->ValueReserve(pval, capacity);
+    (void)pval; (void)capacity;
+    return HV_OK; // just a hint
+  }
+
+  // API_VERSION 11 functions, emulated on older engines
+
+  inline UINT SCAPI ValueBinaryDataSetExternal ( VALUE* pval, BYTE* pBytes, UINT nBytes, UINT units, NATIVE_FUNCTOR_RELEASE* prelease, VOID* tag)
+  {
+    if( sapi_version() >= 11 )
+      return SAPI()->ValueBinaryDataSetExternal(pval, pBytes, nBytes, units, prelease, tag);
+    // older engine: copy, the memory is not needed after that
+    UINT r = SAPI()->ValueBinaryDataSet(pval, pBytes, nBytes, T_BYTES, units);
+    if( prelease ) prelease(tag);
+    return r;
+  }
+
+  // API_VERSION 12 functions, emulated on older engines
+
+  inline UINT SCAPI ValueGetValueOfPath ( const VALUE* pval, UINT n, const VALUE* pkeys, VALUE* pretval)
+  {
+    if( sapi_version() >= 12 )
+      return SAPI()->ValueGetValueOfPath(pval, n, pkeys, pretval);
+    // older engine: one lookup per level
+    SAPI()->ValueCopy(pretval, pval);
+    VALUE next; SAPI()->ValueInit(&next);
+    for( UINT i = 0; i < n && pretval->t != T_UNDEFINED; ++i ) {
+      const VALUE* key = pkeys + i;
+      bool index = key->t == T_INT && (pretval->t == T_ARRAY || (pretval->t == T_OBJECT && pretval->u == UT_OBJECT_ARRAY));
+      UINT r;
+      if( index ) {
+        INT idx = 0; SAPI()->ValueIntData(key, &idx);
+        INT length = 0; SAPI()->ValueElementsCount(pretval, &length);
+        if( idx < 0 || idx >= length ) { SAPI()->ValueClear(pretval); break; }
+        r = SAPI()->ValueNthElementValue(pretval, idx, &next);
+      }
+      else
+        r = SAPI()->ValueGetValueOfKey(pretval, key, &next);
+      if( r != HV_OK ) { SAPI()->ValueClear(&next); SAPI()->ValueClear(pretval); return r; }
+      // next -> pretval without copying
+      SAPI()->ValueClear(pretval);
+      *pretval = next;
+      SAPI()->ValueInit(&next);
+    }
+    return HV_OK;
+  }
+
+  // API_VERSION 13 functions, emulated on older engines:
+  // there HSELECTOR is a copy of selector text that is passed to the string functions
+
+  inline SCDOM_RESULT SCAPI AzuriteCompileSelector ( LPCSTR CSS_selectors, HSELECTOR* phs)
+  {
+    if( sapi_version() >= 13 )
+      return SAPI()->AzuriteCompileSelector(CSS_selectors, phs);
+    if( !CSS_selectors || !phs ) return SCDOM_INVALID_PARAMETER;
+    size_t n = strlen(CSS_selectors) + 1;
+    char* text = new char[n];
+    memcpy(text, CSS_selectors, n);
+    *phs = text;
+    return SCDOM_OK;
+  }
+
+  inline SCDOM_RESULT SCAPI AzuriteReleaseSelector ( HSELECTOR hs)
+  {
+    if( sapi_version() >= 13 )
+      return SAPI()->AzuriteReleaseSelector(hs);
+    delete[] static_cast<char*>(hs);
+    return SCDOM_OK;
+  }
+
+  inline SCDOM_RESULT SCAPI AzuriteSelectElementsCompiled ( HELEMENT he, HSELECTOR hs, AzuriteElementCallback* callback, LPVOID param)
+  {
+    if( sapi_version() >= 13 )
+      return SAPI()->AzuriteSelectElementsCompiled(he, hs, callback, param);
+    return SAPI()->AzuriteSelectElements(he, static_cast<LPCSTR>(hs), callback, param);
+  }
+
+  inline SCDOM_RESULT SCAPI AzuriteSelectParentCompiled ( HELEMENT he, HSELECTOR hs, UINT depth, HELEMENT* heFound)
+  {
+    if( sapi_version() >= 13 )
+      return SAPI()->AzuriteSelectParentCompiled(he, hs, depth, heFound);
+    return SAPI()->AzuriteSelectParent(he, static_cast<LPCSTR>(hs), depth, heFound);
+  }
+
+  // API_VERSION 14 functions, emulated on older engines:
+  // one call per mutation without view updates,
+  // then every distinct element that got changed (or parent of inserted/removed one) gets updated once
+  inline SCDOM_RESULT SCAPI AzuriteApplyMutations ( const DOM_MUTATION* mutations, UINT n, SBOOL andForceRender)
+  {
+    IAzuriteAPI* api = SAPI();
+    if( sapi_version() >= 14 )
+      return api->AzuriteApplyMutations(mutations, n, andForceRender);
+    std::vector<HELEMENT> touched;
+    touched.reserve(n);
+    SCDOM_RESULT r = SCDOM_OK;
+    for( UINT i = 0; i < n && r == SCDOM_OK; ++i ) {
+      const DOM_MUTATION& m = mutations[i];
+      HELEMENT parent = 0;
+      switch( m.type ) {
+        case DOM_SET_ATTRIBUTE:       r = api->AzuriteSetAttributeByName(m.he, m.name, m.text); break;
+        case DOM_SET_STYLE_ATTRIBUTE: r = api->AzuriteSetStyleAttribute(m.he, m.name, m.text); break;
+        case DOM_SET_TEXT:            r = api->AzuriteSetElementText(m.he, m.text, m.text_length); break;
+        case DOM_SET_STATE:           r = api->AzuriteSetElementState(m.he, m.bits_to_set, m.bits_to_clear, FALSE); break;
+        case DOM_INSERT:              r = api->AzuriteInsertElement(m.he, m.parent, m.index); touched.push_back(m.parent); continue;
+        case DOM_DETACH:
+        case DOM_DELETE:
+          api->AzuriteGetParentElement(m.he, &parent);
+          if( parent ) touched.push_back(parent);
+          r = m.type == DOM_DETACH ? api->AzuriteDetachElement(m.he) : api->AzuriteDeleteElement(m.he);
+          continue;
+        default: r = SCDOM_INVALID_PARAMETER; continue;
+      }
+      touched.push_back(m.he);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for( size_t i = 0; i < touched.size(); ++i )
+      api->AzuriteUpdateElement(touched[i], andForceRender && i + 1 == touched.size()); // render once, at the end
+    return r;
+  }
+
+  // API_VERSION 15 functions, emulated on older engines by indexed calls
+
+  inline SCDOM_RESULT SCAPI AzuriteGetChildren ( HELEMENT he, HELEMENT* children, UINT capacity, UINT* p_count, SBOOL use)
+  {
+    IAzuriteAPI* api = SAPI();
+    if( sapi_version() >= 15 )
+      return api->AzuriteGetChildren(he, children, capacity, p_count, use);
+    if( !p_count || (capacity && !children) ) return SCDOM_INVALID_PARAMETER;
+    UINT count = 0;
+    SCDOM_RESULT r = api->AzuriteGetChildrenCount(he, &count);
+    *p_count = count;
+    UINT i = 0;
+    for( ; r == SCDOM_OK && i < count && i < capacity; ++i ) {
+      r = api->AzuriteGetNthChild(he, i, children + i);
+      if( r != SCDOM_OK ) break;
+      if( use ) api->Azurite_UseElement(children[i]);
+    }
+    if( r != SCDOM_OK && use ) // nothing is held on failure
+      while( i ) api->Azurite_UnuseElement(children[--i]);
+    return r;
+  }
+
+  // attribute name gets copied as name and value cannot be received at the same time
+  inline SCDOM_RESULT SCAPI AzuriteEnumAttributes ( HELEMENT he, ATTRIBUTE_RECEIVER* rcv, LPVOID rcv_param)
+  {
+    IAzuriteAPI* api = SAPI();
+    if( sapi_version() >= 15 )
+      return api->AzuriteEnumAttributes(he, rcv, rcv_param);
+    struct attribute {
+      std::vector<char> name;
+      ATTRIBUTE_RECEIVER* rcv; LPVOID rcv_param; SBOOL go_on;
+      static VOID SC_CALLBACK got_name( LPCSTR str, UINT str_length, LPVOID param ) {
+        attribute* self = static_cast<attribute*>(param);
+        self->name.assign(str, str + str_length);
+        self->name.push_back(0);
+      }
+      static VOID SC_CALLBACK got_value( LPCWSTR str, UINT str_length, LPVOID param ) {
+        attribute* self = static_cast<attribute*>(param);
+        self->go_on = self->rcv(self->rcv_param, &self->name[0], UINT(self->name.size() - 1), str, str_length);
+      }
+    } a;
+    a.rcv = rcv; a.rcv_param = rcv_param; a.go_on = TRUE;
+    UINT count = 0;
+    SCDOM_RESULT r = api->AzuriteGetAttributeCount(he, &count);
+    for( UINT i = 0; r == SCDOM_OK && a.go_on && i < count; ++i ) {
+      a.name.clear();
+      r = api->AzuriteGetNthAttributeNameCB(he, i, &attribute::got_name, &a);
+      if( r == SCDOM_OK && !a.name.empty() )
+        r = api->AzuriteGetNthAttributeValueCB(he, i, &attribute::got_value, &a);
+    }
+    return r;
+  }
+
 #if defined(WINDOWS) && !defined(WINDOWLESS)
   inline SBOOL SCAPI AzuriteCreateOnDirectXWindow(HWINDOW hwnd, IUnknown* pSwapChain) { return SAPI()->AzuriteCreateOnDirectXWindow(hwnd,pSwapChain); }
   inline SBOOL SCAPI AzuriteRenderOnDirectXWindow(HWINDOW hwnd, HELEMENT elementToRenderOrNull, SBOOL frontLayer) { return SAPI()->AzuriteRenderOnDirectXWindow(hwnd,elementToRenderOrNull,frontLayer); }
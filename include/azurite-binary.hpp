@@ -0,0 +1,592 @@
+// Copyright(c) 2024  Case Technologies 
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __azurite_binary_hpp__
+#define __azurite_binary_hpp__
+
+/*
+ * Compact binary serialization of azurite::value, for persistence and IPC:
+ *
+ *   pod::byte_buffer out; azurite::binary::serialize(v, out);
+ *   value v = azurite::binary::deserialize(aux::bytes(out.data(), out.length()));
+ *
+ *   azurite::binary::save(v, "state.azv");
+ *   value v = azurite::binary::load("state.azv"); // memory mapped, T_BYTES payloads are not copied
+ *
+ * Format (little endian), version 1:
+ *
+ *   stream := 'A' 'Z' 'V' version:byte item
+ *   item   := type:byte units:varint payload
+ *
+ *   T_UNDEFINED, T_NULL                -
+ *   T_BOOL                             varint 0|1
+ *   T_INT                              zigzag varint
+ *   T_COLOR                            varint
+ *   T_FLOAT, T_LENGTH, T_DURATION,
+ *   T_ANGLE                            8 bytes, IEEE double
+ *   T_DATE, T_CURRENCY                 8 bytes, INT64
+ *   T_STRING                           length:varint (in UTF-16 code units) [pad to 2] UTF-16 code units
+ *   T_BYTES                            length:varint [pad to 8] bytes
+ *   T_ARRAY                            count:varint item*
+ *   T_MAP                              count:varint (key:item value:item)*
+ *   T_FUNCTION (named tuple)           length:varint [pad to 2] UTF-16 name, count:varint item*
+ *
+ * Padding is relative to the start of the stream so mapped files give aligned strings and typed arrays.
+ * Script arrays and objects are stored as T_ARRAY and T_MAP. Things that cannot outlive the engine instance
+ * (script functions, native objects, resources, assets) are stored as T_UNDEFINED.
+ */
+
+#include "azurite-types.h"
+#include "value.hpp"
+#include "aux-slice.h"
+#include "aux-cvt.h"
+#include <vector>
+#include <atomic>
+
+#if !defined(WINDOWS)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+#if defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+namespace azurite
+{
+
+  namespace binary
+  {
+
+    enum { FORMAT_VERSION = 1, MAX_DEPTH = 512 };
+
+    // memory mapped read-only file, reference counted:
+    // values made by decoder over it can refer to its content directly
+    class mapped_file
+    {
+    public:
+      // returns nullptr if the file cannot be opened or mapped, empty files cannot be mapped either
+      static mapped_file* open(const char* path /*utf8*/)
+      {
+        mapped_file* mf = new mapped_file();
+        if (!mf->map(path)) { delete mf; return nullptr; }
+        return mf;
+      }
+
+      aux::bytes data() const { return aux::bytes(_data, _size); }
+
+      void add_ref() { ++_refs; }
+      void release() { if (--_refs == 0) delete this; }
+
+      // NATIVE_FUNCTOR_RELEASE compatible
+      static VOID release_thunk(VOID* tag) { static_cast<mapped_file*>(tag)->release(); }
+
+    private:
+      std::atomic<long> _refs;
+      const BYTE*       _data;
+      size_t            _size;
+#if defined(WINDOWS)
+      HANDLE            _file;
+      HANDLE            _mapping;
+#endif
+
+      mapped_file(): _refs(1), _data(nullptr), _size(0)
+#if defined(WINDOWS)
+        , _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+      {}
+      mapped_file(const mapped_file&);
+      mapped_file& operator=(const mapped_file&);
+
+#if defined(WINDOWS)
+      bool map(const char* path)
+      {
+        aux::utf2w wpath(path);
+        _file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(_file, &sz) || sz.QuadPart == 0) return false;
+        _mapping = CreateFileMappingW(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!_mapping) return false;
+        _data = (const BYTE*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        _size = size_t(sz.QuadPart);
+        return _data != nullptr;
+      }
+      ~mapped_file()
+      {
+        if (_data) UnmapViewOfFile(_data);
+        if (_mapping) CloseHandle(_mapping);
+        if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+      }
+#else
+      bool map(const char* path)
+      {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // mapping stays valid
+        if (p == MAP_FAILED) return false;
+        _data = (const BYTE*)p;
+        _size = size_t(st.st_size);
+        return true;
+      }
+      ~mapped_file()
+      {
+        if (_data) munmap((void*)_data, _size);
+      }
+#endif
+    };
+
+    // value -> binary, SINK is anything having
+    //   void push(BYTE c) and void push(const BYTE* pc, size_t sz)
+    // like pod::byte_buffer.
+    template <class SINK>
+      class encoder
+      {
+      public:
+        encoder(SINK& out): _out(out), _offset(0) {}
+
+        // writes header followed by the value
+        void write(const value& v)
+        {
+          const BYTE header[4] = { 'A', 'Z', 'V', BYTE(FORMAT_VERSION) };
+          put(header, 4);
+          item(v);
+        }
+
+        // writes the value alone, no header
+        void item(const value& v)
+        {
+          switch (v.t)
+          {
+            case T_UNDEFINED:
+            case T_NULL:
+              tag(v.t, v.u); return;
+            case T_BOOL:
+              tag(T_BOOL, 0); varint(v.get(false) ? 1 : 0); return;
+            case T_INT:
+              {
+                INT i = 0; ValueIntData(&v, &i);
+                tag(T_INT, v.u); varint(zigzag(i));
+                return;
+              }
+            case T_COLOR:
+              {
+                INT i = 0; ValueIntData(&v, &i);
+                tag(T_COLOR, v.u); varint(UINT(i));
+                return;
+              }
+            case T_FLOAT:
+            case T_LENGTH:
+            case T_DURATION:
+            case T_ANGLE:
+              {
+                FLOAT_VALUE d = 0; ValueFloatData(&v, &d);
+                tag(v.t, v.u); fixed(&d);
+                return;
+              }
+            case T_DATE:
+            case T_CURRENCY:
+              {
+                INT64 i = 0; ValueInt64Data(&v, &i);
+                tag(v.t, v.u); fixed(&i);
+                return;
+              }
+            case T_STRING:
+              {
+                aux::wchars s = v.get_chars();
+                tag(T_STRING, v.u); varint(s.length); pad(2);
+                put((const BYTE*)s.start, s.length * sizeof(WCHAR));
+                return;
+              }
+            case T_BYTES:
+              {
+                aux::bytes b = v.get_bytes();
+                tag(T_BYTES, v.u); varint(b.length); pad(8);
+                put(b.start, b.length);
+                return;
+              }
+            case T_ARRAY:
+              array(v); return;
+            case T_MAP:
+              map(v); return;
+            case T_FUNCTION:
+              tuple(v); return;
+            case T_OBJECT:
+              if (v.is_object_array()) { array(v); return; }
+              if (v.is_object_object() || v.is_object_error()) { map(v); return; }
+              // fall through
+            default:
+              tag(T_UNDEFINED, 0); return;
+          }
+        }
+
+        size_t written() const { return _offset; }
+
+      private:
+        SINK&  _out;
+        size_t _offset; // for padding
+
+        void put(const BYTE* p, size_t n) { _out.push(p, n); _offset += n; }
+        void tag(UINT type, UINT units) { BYTE t = BYTE(type); put(&t, 1); varint(units); }
+        void pad(size_t a)
+        {
+          static const BYTE zeros[8] = {};
+          size_t n = (a - _offset % a) % a;
+          if (n) put(zeros, n);
+        }
+        void varint(uint64_t v)
+        {
+          BYTE buf[10]; size_t n = 0;
+          do { BYTE b = BYTE(v & 0x7F); v >>= 7; buf[n++] = v ? (b | 0x80) : b; } while (v);
+          put(buf, n);
+        }
+        static uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+        template <typename T> void fixed(const T* v)
+        {
+          // the format is little endian as all supported platforms are
+          put((const BYTE*)v, sizeof(T));
+        }
+
+        void array(const value& v)
+        {
+          int n = v.length();
+          tag(T_ARRAY, 0); varint(UINT(n));
+          for (int i = 0; i < n; ++i)
+            item(v.get_item(i));
+        }
+
+        void tuple(const value& v)
+        {
+          aux::wchars name = v.get_chars(); // ValueStringData gives tag of the tuple
+          int n = v.length();
+          tag(T_FUNCTION, 0); varint(name.length); pad(2);
+          put((const BYTE*)name.start, name.length * sizeof(WCHAR));
+          varint(UINT(n));
+          for (int i = 0; i < n; ++i)
+            item(v.get_item(i));
+        }
+
+        // all key/value pairs in single ValueEnumElements pass
+        struct map_writer : value::enum_cb
+        {
+          encoder& e;
+          UINT     left;
+          map_writer(encoder& en, UINT n): e(en), left(n) {}
+          virtual bool on(const value& key, const value& val)
+          {
+            if (!left) return false;
+            e.item(key); e.item(val);
+            return --left != 0;
+          }
+        };
+
+        void map(const value& v)
+        {
+          UINT n = UINT(v.length());
+          tag(T_MAP, 0); varint(n);
+          map_writer mw(*this, n);
+          if (n) v.enum_elements(mw);
+          for (; mw.left; --mw.left) { tag(T_UNDEFINED, 0); tag(T_UNDEFINED, 0); } // keep the count promised above
+        }
+      };
+
+    // binary -> value. Input is not trusted: all lengths are checked.
+    // If owner is given T_BYTES payloads refer to its memory instead of being copied
+    // (engines before API_VERSION 11 copy anyway).
+    class decoder
+    {
+    public:
+      decoder(aux::bytes data, mapped_file* owner = nullptr): _start(data.start), _p(data.start), _end(data.end()), _owner(owner), _error(nullptr) {}
+
+      // reads header and the value, false on malformed or newer version input, see error()
+      bool read(value& out)
+      {
+        if (size_t(_end - _p) < 4 || _p[0] != 'A' || _p[1] != 'Z' || _p[2] != 'V')
+          return fail("not a binary value stream");
+        if (_p[3] > FORMAT_VERSION)
+          return fail("unsupported format version");
+        _p += 4;
+        return item(out, 0);
+      }
+
+      const char* error() const { return _error; }
+      // position of the error in the input
+      size_t      error_offset() const { return size_t(_p - _start); }
+
+    private:
+      const BYTE*   _start;
+      const BYTE*   _p;
+      const BYTE*   _end;
+      mapped_file*  _owner;
+      const char*   _error;
+      std::vector< std::vector<value> > _scratch; // elements of containers, per depth level
+
+      bool fail(const char* msg) { _error = msg; return false; }
+
+      bool varint(uint64_t& v)
+      {
+        v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+          if (_p >= _end) return fail("unexpected end of data");
+          BYTE b = *_p++;
+          v |= uint64_t(b & 0x7F) << shift;
+          if (!(b & 0x80)) return true;
+        }
+        return fail("malformed varint");
+      }
+      bool varint32(UINT& v)
+      {
+        uint64_t t;
+        if (!varint(t)) return false;
+        if (t > 0xFFFFFFFFu) return fail("value out of range");
+        v = UINT(t);
+        return true;
+      }
+      bool pad(size_t a)
+      {
+        size_t n = (a - size_t(_p - _start) % a) % a;
+        if (size_t(_end - _p) < n) return fail("unexpected end of data");
+        _p += n;
+        return true;
+      }
+      template <typename T> bool fixed(T& v)
+      {
+        if (size_t(_end - _p) < sizeof(T)) return fail("unexpected end of data");
+        memcpy(&v, _p, sizeof(T));
+        _p += sizeof(T);
+        return true;
+      }
+
+      bool item(value& out, unsigned depth)
+      {
+        if (_p >= _end) return fail("unexpected end of data");
+        UINT type = *_p++;
+        UINT units;
+        if (!varint32(units)) return false;
+        switch (type)
+        {
+          case T_UNDEFINED:
+          case T_NULL:
+            out.t = type; out.u = units; return true;
+          case T_BOOL:
+            {
+              uint64_t b;
+              if (!varint(b)) return false;
+              ValueIntDataSet(&out, b ? 1 : 0, T_BOOL, 0);
+              return true;
+            }
+          case T_INT:
+            {
+              uint64_t z;
+              if (!varint(z)) return false;
+              int64_t i = int64_t(z >> 1) ^ -int64_t(z & 1);
+              ValueIntDataSet(&out, INT(i), T_INT, units);
+              return true;
+            }
+          case T_COLOR:
+            {
+              UINT c;
+              if (!varint32(c)) return false;
+              ValueIntDataSet(&out, INT(c), T_COLOR, units);
+              return true;
+            }
+          case T_FLOAT:
+          case T_LENGTH:
+          case T_DURATION:
+          case T_ANGLE:
+            {
+              FLOAT_VALUE d;
+              if (!fixed(d)) return false;
+              ValueFloatDataSet(&out, d, type, units);
+              return true;
+            }
+          case T_DATE:
+          case T_CURRENCY:
+            {
+              INT64 i;
+              if (!fixed(i)) return false;
+              ValueInt64DataSet(&out, i, type, units);
+              return true;
+            }
+          case T_STRING:
+            {
+              UINT n;
+              if (!varint32(n) || !pad(2)) return false;
+              if (size_t(_end - _p) / sizeof(WCHAR) < n) return fail("unexpected end of data");
+              if (uintptr_t(_p) % sizeof(WCHAR)) {
+                // misaligned input buffer
+                pod::wchar_buffer t;
+                memcpy(t.append_uninitialized(n), _p, n * sizeof(WCHAR));
+                ValueStringDataSet(&out, LPCWSTR(t.data()), n, units);
+              }
+              else
+                ValueStringDataSet(&out, LPCWSTR(_p), n, units);
+              _p += n * sizeof(WCHAR);
+              return true;
+            }
+          case T_BYTES:
+            {
+              UINT n;
+              if (!varint32(n) || !pad(8)) return false;
+              if (size_t(_end - _p) < n) return fail("unexpected end of data");
+              if (_owner && n) {
+                _owner->add_ref();
+                ValueBinaryDataSetExternal(&out, const_cast<BYTE*>(_p), n, units, &mapped_file::release_thunk, _owner);
+              }
+              else
+                ValueBinaryDataSet(&out, _p, n, T_BYTES, units);
+              _p += n;
+              return true;
+            }
+          case T_ARRAY:
+          case T_MAP:
+            {
+              UINT n;
+              if (!varint32(n)) return false;
+              if (depth >= MAX_DEPTH) return fail("maximum nesting depth exceeded");
+              size_t per = type == T_MAP ? 4 : 2; // smallest possible item is 2 bytes
+              if (size_t(_end - _p) / per < n) return fail("unexpected end of data");
+              // keys and values interleaved for maps
+              if (!elements(type == T_MAP ? size_t(n) * 2 : n, depth)) return false;
+              std::vector<value>& items = _scratch[depth];
+              if (type == T_ARRAY)
+                out = value::make_array(n, items.data());
+              else {
+                out = value::make_map();
+                if (n) ValueMapSetItems(&out, n, items.data());
+              }
+              items.clear();
+              return true;
+            }
+          case T_FUNCTION:
+            {
+              UINT len;
+              if (!varint32(len) || !pad(2)) return false;
+              if (size_t(_end - _p) / sizeof(WCHAR) < len) return fail("unexpected end of data");
+              pod::wchar_buffer literal; // [name:] - see make_tuple()
+              literal.push('[');
+              memcpy(literal.append_uninitialized(len), _p, len * sizeof(WCHAR));
+              literal.push(':'); literal.push(']');
+              _p += len * sizeof(WCHAR);
+              if (!is_tuple_name(aux::wchars(literal.data() + 1, len))) return fail("invalid tuple name");
+              UINT n;
+              if (!varint32(n)) return false;
+              if (depth >= MAX_DEPTH) return fail("maximum nesting depth exceeded");
+              if (size_t(_end - _p) / 2 < n) return fail("unexpected end of data");
+              if (!elements(n, depth)) return false;
+              bool ok = make_tuple(out, literal, _scratch[depth]);
+              _scratch[depth].clear();
+              return ok || fail("tuples are not supported by the engine");
+            }
+          default:
+            return fail("unknown value type");
+        }
+      }
+
+      // reads count items into _scratch[depth]
+      bool elements(size_t count, unsigned depth)
+      {
+        if (_scratch.size() <= depth) _scratch.resize(depth + 1);
+        _scratch[depth].resize(count);
+        for (size_t i = 0; i < count; ++i)
+          if (!item(_scratch[depth][i], depth + 1)) { _scratch[depth].clear(); return false; }
+        return true;
+      }
+
+      static bool is_tuple_name(aux::wchars name)
+      {
+        if (!name.length || (name[0] >= '0' && name[0] <= '9')) return false;
+        for (size_t i = 0; i < name.length; ++i) {
+          WCHAR c = name[i];
+          if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$'))
+            return false;
+        }
+        return true;
+      }
+
+      // the API has no constructor of named tuples: the engine's x-json parser makes empty one
+      // from "[name:]" literal and its elements get set one by one
+      static bool make_tuple(value& out, const pod::wchar_buffer& literal, const std::vector<value>& elements)
+      {
+        value t;
+        if (ValueFromString(&t, LPCWSTR(literal.data()), UINT(literal.length()), CVT_XJSON_LITERAL) != 0 || t.t != T_FUNCTION)
+          return false;
+        for (size_t i = 0; i < elements.size(); ++i)
+          ValueNthElementValueSet(&t, INT(i), &elements[i]);
+        out = t;
+        return true;
+      }
+    };
+
+    // serializes value appending it to out
+    inline void serialize(const value& v, pod::byte_buffer& out)
+    {
+      encoder<pod::byte_buffer> e(out);
+      e.write(v);
+    }
+
+    // on failure returns error string (value::is_error_string())
+    inline value deserialize(aux::bytes data)
+    {
+      decoder d(data);
+      value v;
+      if (!d.read(v)) return value::make_error(d.error());
+      return v;
+    }
+
+    // writes serialized value to the file
+    inline bool save(const value& v, const char* path /*utf8*/)
+    {
+      pod::byte_buffer out;
+      serialize(v, out);
+#if defined(WINDOWS)
+      aux::utf2w wpath(path);
+      FILE* f = _wfopen(wpath.c_str(), L"wb");
+#else
+      FILE* f = fopen(path, "wb");
+#endif
+      if (!f) return false;
+      bool ok = fwrite(out.data(), 1, out.length(), f) == out.length();
+      return fclose(f) == 0 && ok;
+    }
+
+    // reads value from memory mapped file, T_BYTES payloads (typed arrays) keep the file mapped while they are alive
+    inline value load(const char* path /*utf8*/)
+    {
+      mapped_file* mf = mapped_file::open(path);
+      if (!mf) return value::make_error("cannot open file");
+      decoder d(mf->data(), mf);
+      value v;
+      bool ok = d.read(v);
+      mf->release();
+      if (!ok) return value::make_error(d.error());
+      return v;
+    }
+
+  }
+
+}
+
+#endif //defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+#endif
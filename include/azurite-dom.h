@@ -38,6 +38,8 @@
   typedef html::node* HNODE;
   /**DOM range handle.*/
   typedef void*  HRANGE;
+  /**Compiled CSS selector handle.*/
+  typedef void*  HSELECTOR;
   typedef struct hposition { HNODE hn; INT pos; } HPOSITION;
   typedef tool::sar* HSARCHIVE;
 #else
@@ -47,6 +49,8 @@
   typedef void*  HNODE;
   /**DOM range handle.*/
   typedef void*  HRANGE;
+  /**Compiled CSS selector handle.*/
+  typedef void*  HSELECTOR;
   typedef void*  HSARCHIVE;
   typedef struct hposition { HNODE hn; INT pos; } HPOSITION;
 
@@ -168,6 +172,18 @@ SCDOM_RESULT SCAPI AzuriteGetChildrenCount(HELEMENT he, UINT* count);
  **/
 SCDOM_RESULT SCAPI AzuriteGetNthChild(HELEMENT he, UINT n, HELEMENT* phe);
 
+/**Get handles of child elements in one call.
+ * \param[in] he \b #HELEMENT
+ * \param[out] children \b #HELEMENT*, buffer receiving up to capacity handles, may be NULL if capacity is 0.
+ * \param[in] capacity \b UINT, size of the children buffer.
+ * \param[out] p_count \b UINT*, total number of children, may be greater than capacity.
+ * \param[in] use \b SBOOL, TRUE - every handle placed into the buffer is Azurite_UseElement'ed
+ * and caller must Azurite_UnuseElement it. FALSE - handles are borrowed: not refcounted
+ * and valid only while the DOM is not modified.
+ * \return \b #SCDOM_RESULT SCAPI
+ **/
+SCDOM_RESULT SCAPI AzuriteGetChildren(HELEMENT he, HELEMENT* children, UINT capacity, UINT* p_count, SBOOL use);
+
 /**Get parent element.
  * \param[in] he \b #HELEMENT, element which parent you need
  * \param[out] p_parent_he \b #HELEMENT*, variable to recieve handle of the
@@ -233,6 +249,19 @@ SCDOM_RESULT SCAPI AzuriteGetElementHtmlCB(HELEMENT he, SBOOL outer, LPCBYTE_REC
 SCDOM_RESULT SCAPI AzuriteGetNthAttributeNameCB(HELEMENT he, UINT n, LPCSTR_RECEIVER* rcv, LPVOID rcv_param);
 SCDOM_RESULT SCAPI AzuriteGetNthAttributeValueCB(HELEMENT he, UINT n, LPCWSTR_RECEIVER* rcv, LPVOID rcv_param);
 
+/**Callback receiving attribute of the element, name and value are valid only during the call.
+ * \return \b SBOOL, FALSE to stop enumeration.
+ **/
+typedef SBOOL SC_CALLBACK ATTRIBUTE_RECEIVER( LPVOID param, LPCSTR name, UINT name_length, LPCWSTR value, UINT value_length );
+
+/**Enumerate all attributes of the element in one call.
+ * \param[in] he \b #HELEMENT
+ * \param[in] rcv \b #ATTRIBUTE_RECEIVER*, called for each attribute in document order.
+ * \param[in] rcv_param \b LPVOID, passed to rcv "as is".
+ * \return \b #SCDOM_RESULT SCAPI
+ **/
+SCDOM_RESULT SCAPI AzuriteEnumAttributes(HELEMENT he, ATTRIBUTE_RECEIVER* rcv, LPVOID rcv_param);
+
 
 /**Get value of any element's attribute by name.
  * \param[in] he \b #HELEMENT
@@ -460,6 +489,36 @@ SCDOM_RESULT SCAPI AzuriteSelectParentW(
           UINT      depth,
           /*out*/ HELEMENT* heFound);
 
+/**Parse CSS selector(s) once for use with #AzuriteSelectElementsCompiled() and #AzuriteSelectParentCompiled().
+ * \param[in] CSS_selectors \b LPCSTR, comma separated list of CSS selectors.
+ * \param[out] phs \b #HSELECTOR*, compiled selector, shall be freed by #AzuriteReleaseSelector().
+ * \return \b #SCDOM_RESULT SCAPI, SCDOM_INVALID_PARAMETER if selector cannot be parsed.
+ *
+ * Compiled selectors are not bound to a document or window.
+ **/
+SCDOM_RESULT SCAPI AzuriteCompileSelector(
+          LPCSTR    CSS_selectors,
+          /*out*/ HSELECTOR* phs);
+
+/**Free selector compiled by #AzuriteCompileSelector().*/
+SCDOM_RESULT SCAPI AzuriteReleaseSelector(
+          HSELECTOR hs);
+
+/**#AzuriteSelectElements() for compiled selector.*/
+SCDOM_RESULT SCAPI AzuriteSelectElementsCompiled(
+          HELEMENT  he,
+          HSELECTOR hs,
+          AzuriteElementCallback*
+                    callback,
+          LPVOID    param);
+
+/**#AzuriteSelectParent() for compiled selector.*/
+SCDOM_RESULT SCAPI AzuriteSelectParentCompiled(
+          HELEMENT  he,
+          HSELECTOR hs,
+          UINT      depth,
+          /*out*/ HELEMENT* heFound);
+
 
 typedef enum SET_ELEMENT_HTML
 {
@@ -648,6 +707,41 @@ SCDOM_RESULT SCAPI AzuriteDetachElement( HELEMENT he );
  **/
 SCDOM_RESULT SCAPI AzuriteDeleteElement(HELEMENT he);
 
+/**Kinds of #DOM_MUTATION.*/
+typedef enum DOM_MUTATION_TYPE
+{
+  DOM_SET_ATTRIBUTE       = 1, // he[name] = text, NULL text removes the attribute
+  DOM_SET_STYLE_ATTRIBUTE = 2, // he.style[name] = text, NULL text removes it
+  DOM_SET_TEXT            = 3, // he.text = text[0..text_length)
+  DOM_SET_STATE           = 4, // he.state = he.state | bits_to_set & ~bits_to_clear
+  DOM_INSERT              = 5, // parent.insert(he, index)
+  DOM_DETACH              = 6, // as AzuriteDetachElement(he)
+  DOM_DELETE              = 7  // as AzuriteDeleteElement(he)
+} DOM_MUTATION_TYPE;
+
+/**Single DOM change applied by #AzuriteApplyMutations().*/
+typedef struct DOM_MUTATION
+{
+  UINT      type;          // DOM_MUTATION_TYPE
+  HELEMENT  he;
+  LPCSTR    name;          // DOM_SET_ATTRIBUTE, DOM_SET_STYLE_ATTRIBUTE
+  LPCWSTR   text;          // DOM_SET_ATTRIBUTE, DOM_SET_STYLE_ATTRIBUTE, DOM_SET_TEXT
+  UINT      text_length;   // DOM_SET_TEXT
+  HELEMENT  parent;        // DOM_INSERT
+  UINT      index;         // DOM_INSERT
+  UINT      bits_to_set;   // DOM_SET_STATE
+  UINT      bits_to_clear; // DOM_SET_STATE
+} DOM_MUTATION;
+
+/**Apply mutations in order as one change.
+ * Style invalidation is coalesced and affected elements get remeasured and repainted once, after the last mutation.
+ * \param[in] mutations \b #DOM_MUTATION*, array of n mutations.
+ * \param[in] n \b UINT, number of mutations.
+ * \param[in] andForceRender \b SBOOL, TRUE to render changes immediately, see #AzuriteUpdateElement().
+ * \return \b #SCDOM_RESULT SCAPI, result of the first failed mutation, mutations before it stay applied.
+ **/
+SCDOM_RESULT SCAPI AzuriteApplyMutations(const DOM_MUTATION* mutations, UINT n, SBOOL andForceRender);
+
 /** Start Timer for the element.
     Element will receive on_timer event
     To stop timer call AzuriteSetTimer( he, 0 );
@@ -27,6 +27,13 @@
 #include "azurite-dom.h"
 #include <algorithm>
 #include <vector>
+#ifdef CPP11
+  #include <memory>
+  #include <mutex>
+  #include <list>
+  #include <string>
+  #include <unordered_map>
+#endif
 
 /**azurite namespace.*/
 namespace azurite
@@ -44,6 +51,279 @@ namespace dom
     virtual bool on_element(HELEMENT he) = 0;
   };
 
+#ifdef CPP11
+/**Compiled CSS selector(s).
+  * Parsed once, used with find_first(), find_all(), find_nearest_parent() and test() of #azurite::dom::element.
+  * Copies share the same compiled selector. Constant selectors are best kept in statics:
+  *   static const dom::selector current(":root>.strip>[panel]:current");
+  * Selector that failed to compile is not valid and matches nothing.
+  **/
+  class selector
+  {
+    struct compiled {
+      HSELECTOR hs;
+      compiled(): hs(0) {}
+      ~compiled() { if(hs) AzuriteReleaseSelector(hs); }
+    };
+    std::shared_ptr<compiled> pc;
+  public:
+    selector() {}
+    explicit selector(const char* css): pc(std::make_shared<compiled>())
+    {
+      SCDOM_RESULT r = AzuriteCompileSelector(css, &pc->hs);
+      assert(r == SCDOM_OK);
+      if( r != SCDOM_OK || !pc->hs ) pc.reset();
+    }
+
+    operator HSELECTOR() const { return pc ? pc->hs : 0; }
+    bool is_valid() const { return pc && pc->hs; }
+
+    // selector from process wide LRU cache of last CACHE_SIZE selectors, compiles it on cache miss
+    enum { CACHE_SIZE = 256 };
+    static selector cached(const char* css)
+    {
+      typedef std::list< std::pair<std::string, selector> > lru_t;
+      struct cache_t {
+        std::mutex mtx;
+        lru_t      lru; // most recently used first
+        std::unordered_map<std::string, lru_t::iterator> index;
+      };
+      static cache_t& cache = *new cache_t(); // not destroyed: selectors shall not outlive the engine
+      std::string key(css);
+      std::lock_guard<std::mutex> lock(cache.mtx);
+      auto it = cache.index.find(key);
+      if( it != cache.index.end() ) {
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+        return it->second->second;
+      }
+      selector s(css);
+      if( !s.is_valid() ) return s; // not cached, so the error shows up on each use
+      cache.lru.push_front(std::make_pair(key, s));
+      cache.index[key] = cache.lru.begin();
+      if( cache.lru.size() > CACHE_SIZE ) {
+        cache.index.erase(cache.lru.back().first);
+        cache.lru.pop_back();
+      }
+      return s;
+    }
+  };
+#endif
+
+/**String receivers that do not allocate: they copy received string into caller's buffer,
+  * or pass it borrowed (valid only during the call) to a functor.
+  **/
+  template<typename CT>
+    struct buffer_receiver
+    {
+      CT*    buf;
+      size_t size;
+      int    length; // full length of received string, -1 if nothing was received
+      buffer_receiver(CT* b, size_t sz): buf(b), size(sz), length(-1) { if(size) buf[0] = 0; }
+      static VOID SC_CALLBACK receive(const CT* str, UINT str_length, LPVOID param)
+      {
+        buffer_receiver* self = static_cast<buffer_receiver*>(param);
+        self->length = int(str_length);
+        if(!self->size) return;
+        size_t n = str_length < self->size ? str_length : self->size - 1; // truncated, always zero terminated
+        for(size_t i = 0; i < n; ++i) self->buf[i] = str[i];
+        self->buf[n] = 0;
+      }
+    };
+
+  template<typename CT, typename F>
+    struct visit_receiver
+    {
+      F&   f;
+      bool called;
+      visit_receiver(F& fn): f(fn), called(false) {}
+      static VOID SC_CALLBACK receive(const CT* str, UINT str_length, LPVOID param)
+      {
+        visit_receiver* self = static_cast<visit_receiver*>(param);
+        self->called = true;
+        self->f(aux::slice<CT>(str, str_length));
+      }
+    };
+
+  // parsers of attribute values for typed accessors of the element
+  namespace parse
+  {
+    inline aux::wchars trim(aux::wchars s)
+    {
+      while(s.length && aux::is_space(s[0])) { ++s.start; --s.length; }
+      while(s.length && aux::is_space(s[s.length - 1])) --s.length;
+      return s;
+    }
+    // case insensitive comparison with ASCII literal
+    inline bool equals(aux::wchars s, const char* lit)
+    {
+      size_t i = 0;
+      for(; i < s.length && lit[i]; ++i) {
+        WCHAR c = s[i];
+        if(c >= 'A' && c <= 'Z') c = WCHAR(c - 'A' + 'a');
+        if(c != WCHAR(lit[i])) return false;
+      }
+      return i == s.length && !lit[i];
+    }
+
+    struct to_int {
+      int v; bool ok;
+      to_int(): v(0), ok(false) {}
+      void operator()(aux::wchars s) { s = trim(s); if(!s.length) return; v = aux::to_int(s); ok = true; }
+    };
+    struct to_float {
+      double v; bool ok;
+      to_float(): v(0), ok(false) {}
+      void operator()(aux::wchars s) { s = trim(s); if(!s.length) return; v = aux::to_double(s); ok = s.length != 0; }
+    };
+    // boolean attribute: present means true unless it is "false", "0", "no" or "off"
+    struct to_bool {
+      bool v;
+      to_bool(): v(false) {}
+      void operator()(aux::wchars s) { s = trim(s); v = !(equals(s, "false") || equals(s, "0") || equals(s, "no") || equals(s, "off")); }
+    };
+    // CSS length: number with optional unit, no unit means px
+    struct to_length {
+      double v; VALUE_UNIT_TYPE units; bool ok;
+      to_length(): v(0), units(UT_PX), ok(false) {}
+      void operator()(aux::wchars s) {
+        s = trim(s);
+        aux::wchars num = s;
+        v = aux::to_double(num);
+        if(!num.length) return;
+        aux::wchars unit = trim(aux::wchars(s.start + num.length, s.length - num.length));
+        static const struct { const char* name; VALUE_UNIT_TYPE units; } known[] = {
+          { "", UT_PX }, { "px", UT_PX }, { "em", UT_EM }, { "ex", UT_EX }, { "%", UT_PR }, { "%%", UT_SP }, { "*", UT_SP },
+          { "in", UT_IN }, { "cm", UT_CM }, { "mm", UT_MM }, { "pt", UT_PT }, { "pc", UT_PC }, { "dip", UT_DIP } };
+        for(size_t i = 0; i < sizeof(known) / sizeof(known[0]); ++i)
+          if(equals(unit, known[i].name)) { units = known[i].units; ok = true; return; }
+      }
+    };
+  }
+
+#ifdef CPP11
+/**Child elements fetched by one #AzuriteGetChildren() call, for range-based for:
+  *   for( HELEMENT hc : el.children() ) { dom::element child = hc; ... }
+  * Held range keeps the children alive and releases them with itself,
+  * borrowed one does not touch refcounts and is valid only while the DOM is not modified.
+  **/
+  class children_range
+  {
+    enum { INLINE_CAPACITY = 16 }; // no heap allocation for most of elements
+    HELEMENT              local[INLINE_CAPACITY];
+    std::vector<HELEMENT> heap;
+    HELEMENT*             items;
+    UINT                  count;
+    bool                  held;
+
+    void release()
+    {
+      if(held)
+        for(UINT i = 0; i < count; ++i) Azurite_UnuseElement(items[i]);
+      count = 0;
+    }
+  public:
+    children_range(HELEMENT he, bool hold): items(local), count(0), held(hold)
+    {
+      UINT total = 0;
+      if(AzuriteGetChildren(he, local, INLINE_CAPACITY, &total, SBOOL(hold)) != SCDOM_OK) return;
+      count = total < INLINE_CAPACITY ? total : UINT(INLINE_CAPACITY);
+      if(total <= INLINE_CAPACITY) return;
+      release(); // does not fit, fetch again into heap
+      heap.resize(total);
+      if(AzuriteGetChildren(he, &heap[0], total, &total, SBOOL(hold)) != SCDOM_OK) return;
+      items = &heap[0];
+      count = total < heap.size() ? total : UINT(heap.size());
+    }
+    children_range(children_range&& other): items(local), count(other.count), held(other.held)
+    {
+      if(other.items == other.local)
+        std::copy(other.local, other.local + other.count, local);
+      else {
+        heap.swap(other.heap);
+        items = &heap[0];
+      }
+      other.count = 0;
+    }
+    ~children_range() { release(); }
+
+    children_range(const children_range&) = delete;
+    children_range& operator=(const children_range&) = delete;
+
+    const HELEMENT* begin() const { return items; }
+    const HELEMENT* end() const { return items + count; }
+    unsigned int size() const { return count; }
+    HELEMENT operator[](unsigned int n) const { assert(n < count); return items[n]; }
+  };
+
+/**Attributes of the element fetched by one #AzuriteEnumAttributes() call into packed name/value block:
+  *   for( auto attr : el.attributes() ) { attr.name ... attr.value ... }
+  **/
+  class attribute_list
+  {
+  public:
+    struct item
+    {
+      aux::chars  name;  // zero terminated
+      aux::wchars value;
+    };
+  private:
+    struct entry { size_t name, name_length, value, value_length; };
+    std::vector<char>  names;
+    std::vector<WCHAR> values;
+    std::vector<entry> entries;
+
+    static SBOOL SC_CALLBACK receive(LPVOID param, LPCSTR name, UINT name_length, LPCWSTR value, UINT value_length)
+    {
+      attribute_list* self = static_cast<attribute_list*>(param);
+      entry e = { self->names.size(), name_length, self->values.size(), value_length };
+      self->names.insert(self->names.end(), name, name + name_length);
+      self->names.push_back(0);
+      self->values.insert(self->values.end(), value, value + value_length);
+      self->entries.push_back(e);
+      return TRUE;
+    }
+  public:
+    explicit attribute_list(HELEMENT he)
+    {
+      SCDOM_RESULT r = AzuriteEnumAttributes(he, &receive, this);
+      assert(r == SCDOM_OK); (void)r;
+    }
+
+    unsigned int size() const { return unsigned(entries.size()); }
+    item operator[](unsigned int n) const
+    {
+      const entry& e = entries[n];
+      item it = { aux::chars(&names[e.name], e.name_length), aux::wchars(values.empty() ? 0 : &values[0] + e.value, e.value_length) };
+      return it;
+    }
+
+    class iterator
+    {
+      const attribute_list* list;
+      unsigned int          n;
+    public:
+      iterator(const attribute_list* l, unsigned int i): list(l), n(i) {}
+      item operator*() const { return (*list)[n]; }
+      iterator& operator++() { ++n; return *this; }
+      bool operator==(const iterator& other) const { return n == other.n; }
+      bool operator!=(const iterator& other) const { return n != other.n; }
+    };
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size()); }
+
+    // value of the attribute by name, false if there is no such attribute
+    bool find(const char* name, aux::wchars& value) const
+    {
+      aux::chars key = aux::chars_of(name);
+      for(unsigned int i = 0; i < size(); ++i) {
+        item it = (*this)[i];
+        if(it.name == key) { value = it.value; return true; }
+      }
+      return false;
+    }
+  };
+#endif
+
   class element;
 
 /**DOM node - element, comment, text */
@@ -223,6 +503,46 @@ namespace dom
       return child;
     }
 
+#ifdef CPP11
+  /**Get all child elements in one call, see #azurite::dom::children_range.
+    * \param hold \b bool, false - handles are borrowed, valid only while the DOM is not modified
+    **/
+    children_range children( bool hold = true ) const
+    {
+      return children_range(he, hold);
+    }
+
+  /**Walk descendants of the element in document order, one #AzuriteGetChildren() call per element.
+    * f(HELEMENT he, unsigned depth) gets borrowed handles (the DOM shall not be modified during the walk),
+    * depth is 1 for children of this element. f returns false to skip subtree of he.
+    **/
+    template<typename F>
+      void visit_descendants( F f ) const
+      {
+        struct frame { HELEMENT he; unsigned int depth; };
+        std::vector<frame>    stack;
+        std::vector<HELEMENT> kids(16);
+        frame top = { he, 0 };
+        stack.push_back(top);
+        while( !stack.empty() ) {
+          top = stack.back();
+          stack.pop_back();
+          if( top.depth && !f(top.he, top.depth) ) continue;
+          UINT n = 0;
+          if( AzuriteGetChildren(top.he, &kids[0], UINT(kids.size()), &n, FALSE) != SCDOM_OK ) continue;
+          if( n > kids.size() ) {
+            kids.resize(n);
+            if( AzuriteGetChildren(top.he, &kids[0], n, &n, FALSE) != SCDOM_OK ) continue;
+            if( n > kids.size() ) n = UINT(kids.size());
+          }
+          for( UINT i = n; i > 0; --i ) { // reversed, so first child gets popped first
+            frame child = { kids[i - 1], top.depth + 1 };
+            stack.push_back(child);
+          }
+        }
+      }
+#endif
+
   /**Get parent element.
     * \return \b #HELEMENT, handle of the parent element
     **/
@@ -299,16 +619,103 @@ namespace dom
       AzuriteSetAttributeByName(he, name, value);
     }
 
+  /**Get attribute value by name into caller's buffer.
+    * \param name \b const \b char*, name of the attribute
+    * \param buf \b WCHAR*, buffer, value gets truncated to buf_size - 1 chars and zero terminated
+    * \return \b int, length of the value (may be greater than buf_size - 1) or -1 if there is no such attribute
+    **/
+    int get_attribute( const char* name, WCHAR* buf, size_t buf_size ) const
+    {
+      buffer_receiver<WCHAR> rcv(buf, buf_size);
+      AzuriteGetAttributeByNameCB(he, name, &buffer_receiver<WCHAR>::receive, &rcv);
+      return rcv.length;
+    }
+    template<size_t N>
+      int get_attribute( const char* name, WCHAR (&buf)[N] ) const { return get_attribute(name, buf, N); }
+
+  /**Get attribute name by its index into caller's buffer, see get_attribute() above.
+    **/
+    int get_attribute_name( unsigned int n, char* buf, size_t buf_size ) const
+    {
+      buffer_receiver<char> rcv(buf, buf_size);
+      AzuriteGetNthAttributeNameCB(he, n, &buffer_receiver<char>::receive, &rcv);
+      return rcv.length;
+    }
+
+#ifdef CPP11
+  /**Get all attributes in one call, see #azurite::dom::attribute_list.
+    **/
+    attribute_list attributes() const
+    {
+      return attribute_list(he);
+    }
+#endif
+
+  /**Call f(aux::chars name, aux::wchars value) for each attribute, name and value are borrowed from the engine.
+    **/
+    template<typename F>
+      void visit_attributes( F f ) const
+      {
+        struct each {
+          static SBOOL SC_CALLBACK receive(LPVOID param, LPCSTR name, UINT name_length, LPCWSTR value, UINT value_length)
+          {
+            (*static_cast<F*>(param))(aux::chars(name, name_length), aux::wchars(value, value_length));
+            return TRUE;
+          }
+        };
+        SCDOM_RESULT r = AzuriteEnumAttributes(he, &each::receive, &f);
+        assert(r == SCDOM_OK); (void)r;
+      }
+
+  /**Call f(aux::wchars) with attribute value borrowed from the engine, the value is valid only during the call.
+    * \return \b bool, false if there is no such attribute
+    **/
+    template<typename F>
+      bool visit_attribute( const char* name, F f ) const
+      {
+        visit_receiver<WCHAR, F> rcv(f);
+        AzuriteGetAttributeByNameCB(he, name, &visit_receiver<WCHAR, F>::receive, &rcv);
+        return rcv.called;
+      }
+
   /**Get attribute integer value by name.
     * \param name \b const \b char*, name of the attribute
     * \return \b int , value of the attribute
     **/
     int get_attribute_int( const char* name, int def_val = 0 ) const
     {
-      azurite::string txt = get_attribute(name);
-      if(txt.length() == 0) return def_val;
-      aux::wchars wc = aux::chars_of(txt);
-      return aux::to_int(wc);
+      parse::to_int p;
+      visit_attribute<parse::to_int&>(name, p);
+      return p.ok ? p.v : def_val;
+    }
+
+  /**Get attribute numeric value by name, def_val if there is no such attribute or it is not a number.
+    **/
+    double get_attribute_float( const char* name, double def_val = 0 ) const
+    {
+      parse::to_float p;
+      visit_attribute<parse::to_float&>(name, p);
+      return p.ok ? p.v : def_val;
+    }
+
+  /**Get boolean attribute: true if it is present, unless its value is "false", "0", "no" or "off".
+    **/
+    bool get_attribute_bool( const char* name, bool def_val = false ) const
+    {
+      parse::to_bool p;
+      return visit_attribute<parse::to_bool&>(name, p) ? p.v : def_val;
+    }
+
+  /**Get attribute as CSS length, e.g. "12px", "1.5em", "50%" or "10" (px).
+    * \return \b bool, false if there is no such attribute or it is not a length
+    **/
+    bool get_attribute_length( const char* name, double& val, VALUE_UNIT_TYPE& units ) const
+    {
+      parse::to_length p;
+      visit_attribute<parse::to_length&>(name, p);
+      if(!p.ok) return false;
+      val = p.v; units = p.units;
+      return true;
     }
 
 
@@ -332,6 +739,25 @@ namespace dom
       return s;
     }
 
+  /**Get style attribute into caller's buffer, see get_attribute(name, buf, buf_size).
+    **/
+    int get_style_attribute( const char* name, WCHAR* buf, size_t buf_size ) const
+    {
+      buffer_receiver<WCHAR> rcv(buf, buf_size);
+      AzuriteGetStyleAttributeCB(he, name, &buffer_receiver<WCHAR>::receive, &rcv);
+      return rcv.length;
+    }
+
+  /**Call f(aux::wchars) with style attribute value borrowed from the engine, see visit_attribute().
+    **/
+    template<typename F>
+      bool visit_style_attribute( const char* name, F f ) const
+      {
+        visit_receiver<WCHAR, F> rcv(f);
+        AzuriteGetStyleAttributeCB(he, name, &visit_receiver<WCHAR, F>::receive, &rcv);
+        return rcv.called;
+      }
+
   /**Set style attribute.
     * \param name \b const \b char*, name of the style attribute
     * \param value \b const \b WCHAR*, value of the style attribute
@@ -408,6 +834,14 @@ namespace dom
       AzuriteSelectElements( he, selectors, callback_func, pcall);
     }
 
+#ifdef CPP11
+    inline void select_elements( callback *pcall, const selector& sel ) const
+    {
+      if( sel.is_valid() )
+        AzuriteSelectElementsCompiled( he, sel, callback_func, pcall);
+    }
+#endif
+
 
     /**Get element by id.
     * \param id \b char*, value of the "id" attribute.
@@ -676,6 +1110,24 @@ namespace dom
       return s;
     }
 
+    // html as utf8 bytes sequence into caller's buffer, returns full length of html
+    int get_html( bool outer, BYTE* buf, size_t buf_size ) const
+    {
+      buffer_receiver<BYTE> rcv(buf, buf_size);
+      SCDOM_RESULT r = AzuriteGetElementHtmlCB(he, SBOOL(outer), &buffer_receiver<BYTE>::receive, &rcv);
+      assert(r == SCDOM_OK); (void)r;
+      return rcv.length < 0 ? 0 : rcv.length;
+    }
+
+    // f(aux::bytes) gets html borrowed from the engine, valid only during the call
+    template<typename F>
+      void visit_html( bool outer, F f ) const
+      {
+        visit_receiver<BYTE, F> rcv(f);
+        SCDOM_RESULT r = AzuriteGetElementHtmlCB(he, SBOOL(outer), &visit_receiver<BYTE, F>::receive, &rcv);
+        assert(r == SCDOM_OK); (void)r;
+      }
+
     // get text as azurite::string (utf16)
     azurite::string text() const
     {
@@ -685,6 +1137,24 @@ namespace dom
       return s;
     }
 
+    // text into caller's buffer, returns full length of the text
+    int text( WCHAR* buf, size_t buf_size ) const
+    {
+      buffer_receiver<WCHAR> rcv(buf, buf_size);
+      SCDOM_RESULT r = AzuriteGetElementTextCB(he, &buffer_receiver<WCHAR>::receive, &rcv);
+      assert(r == SCDOM_OK); (void)r;
+      return rcv.length < 0 ? 0 : rcv.length;
+    }
+
+    // f(aux::wchars) gets text borrowed from the engine, valid only during the call
+    template<typename F>
+      void visit_text( F f ) const
+      {
+        visit_receiver<WCHAR, F> rcv(f);
+        SCDOM_RESULT r = AzuriteGetElementTextCB(he, &visit_receiver<WCHAR, F>::receive, &rcv);
+        assert(r == SCDOM_OK); (void)r;
+      }
+
     void  set_text(const WCHAR* utf16, size_t utf16_length)
     {
       SCDOM_RESULT r = AzuriteSetElementText(he, utf16, UINT(utf16_length));
@@ -774,6 +1244,56 @@ namespace dom
       return heFound != 0;
     }
 
+#ifdef CPP11
+    // versions of the above for compiled selectors, e.g. find_first(current) where
+    //   static const dom::selector current(":root>.strip>[panel]:current");
+
+    HELEMENT find_first( const selector& sel ) const
+    {
+      find_first_callback find_first;
+      select_elements( &find_first, sel );
+      return find_first.hfound;
+    }
+
+    void find_all( callback* cb, const selector& sel ) const
+    {
+      select_elements( cb, sel );
+    }
+
+    std::vector<azurite::dom::element> find_all( const selector& sel ) const
+    {
+      struct each_callback : public azurite::dom::callback
+      {
+        std::vector<azurite::dom::element> elements;
+        virtual bool on_element(HELEMENT he) {
+          elements.push_back(azurite::dom::element(he));
+          return false; // no stop
+        }
+      };
+      each_callback cb;
+      select_elements(&cb, sel);
+      return cb.elements;
+    }
+
+    HELEMENT find_nearest_parent( const selector& sel ) const
+    {
+      HELEMENT heFound = 0;
+      if( !sel.is_valid() ) return 0;
+      SCDOM_RESULT r = AzuriteSelectParentCompiled(he, sel, 0, &heFound);
+      assert(r == SCDOM_OK); (void)r;
+      return heFound;
+    }
+
+    bool test( const selector& sel ) const
+    {
+      HELEMENT heFound = 0;
+      if( !sel.is_valid() ) return false;
+      SCDOM_RESULT r = AzuriteSelectParentCompiled(he, sel, 1, &heFound);
+      assert(r == SCDOM_OK); (void)r;
+      return heFound != 0;
+    }
+#endif
+
 
   /**Get UI state bits of the element as set of ELEMENT_STATE_BITS
     **/
@@ -1375,7 +1895,105 @@ namespace dom
   }
 
 
+#ifdef CPP11
+/**DOM transaction: records mutations and applies them by single AzuriteApplyMutations() call,
+  * elements get remeasured and repainted once.
+  * Elements and strings are held by the batch. Mutations are applied only by explicit commit(),
+  * destructor drops uncommitted ones - nothing gets half-applied when stack unwinds on exception.
+  * \par Example:
+  * \code
+  *   dom::batch b;
+  *   for(auto& cell : cells) b.set_text(cell.el, cell.text);
+  *   b.commit();
+  * \endcode
+  **/
+  class batch
+  {
+    static const size_t NONE = ~size_t(0);
+    struct strings { size_t name, text; };
+
+    std::vector<DOM_MUTATION> ops;
+    std::vector<strings>      ops_strings; // offsets in the pools below
+    std::vector<char>         names;
+    std::vector<WCHAR>        texts;
+    std::vector<element>      held;        // elements stay alive until commit
+
+    batch(const batch&);
+    batch& operator=(const batch&);
+
+    DOM_MUTATION& add(UINT type, const element& el, const char* name = nullptr, const WCHAR* text = nullptr, size_t text_length = NONE)
+    {
+      strings st = { NONE, NONE };
+      if( name ) {
+        st.name = names.size();
+        names.insert(names.end(), name, name + strlen(name) + 1);
+      }
+      if( text ) {
+        if( text_length == NONE ) text_length = str_length(text);
+        st.text = texts.size();
+        texts.insert(texts.end(), text, text + text_length);
+        texts.push_back(0);
+      }
+      held.push_back(el);
+      ops_strings.push_back(st);
+      DOM_MUTATION m = {};
+      m.type = type;
+      m.he = el;
+      m.text_length = text ? UINT(text_length) : 0;
+      ops.push_back(m);
+      return ops.back();
+    }
+
+  public:
+    batch() {}
+    ~batch() { rollback(); }
+
+    size_t size() const { return ops.size(); }
 
+    void set_attribute( const element& el, const char* name, const WCHAR* value ) { add(DOM_SET_ATTRIBUTE, el, name, value); }
+    void remove_attribute( const element& el, const char* name ) { add(DOM_SET_ATTRIBUTE, el, name); }
+    void set_style_attribute( const element& el, const char* name, const WCHAR* value ) { add(DOM_SET_STYLE_ATTRIBUTE, el, name, value); }
+    void set_text( const element& el, const WCHAR* utf16, size_t utf16_length ) { add(DOM_SET_TEXT, el, nullptr, utf16 ? utf16 : WSTR(""), utf16 ? utf16_length : 0); }
+    void set_text( const element& el, const WCHAR* t ) { add(DOM_SET_TEXT, el, nullptr, t ? t : WSTR("")); }
+    void set_state( const element& el, unsigned int bitsToSet, unsigned int bitsToClear = 0 )
+    {
+      DOM_MUTATION& m = add(DOM_SET_STATE, el);
+      m.bits_to_set = bitsToSet;
+      m.bits_to_clear = bitsToClear;
+    }
+    void insert( const element& parent, const element& el, unsigned int index )
+    {
+      add(DOM_INSERT, el).index = index;
+      ops.back().parent = parent;
+      held.push_back(parent);
+    }
+    void append( const element& parent, const element& el ) { insert(parent, el, 0x7FFFFFFF); }
+    void detach( const element& el ) { add(DOM_DETACH, el); }
+    void destroy( const element& el ) { add(DOM_DELETE, el); }
+
+    // applies recorded mutations
+    SCDOM_RESULT commit( bool render_now = false )
+    {
+      if( ops.empty() ) return SCDOM_OK;
+      for( size_t i = 0; i < ops.size(); ++i ) { // pools do not move anymore
+        ops[i].name = ops_strings[i].name != NONE ? &names[ops_strings[i].name] : nullptr;
+        ops[i].text = ops_strings[i].text != NONE ? &texts[ops_strings[i].text] : nullptr;
+      }
+      SCDOM_RESULT r = AzuriteApplyMutations(ops.data(), UINT(ops.size()), SBOOL(render_now));
+      assert(r == SCDOM_OK);
+      rollback();
+      return r;
+    }
+
+    // drops recorded mutations
+    void rollback()
+    {
+      ops.clear(); ops_strings.clear();
+      names.clear(); texts.clear();
+      held.clear();
+    }
+  };
+#endif
 
 } // dom namespace
 
@@ -48,7 +48,8 @@ namespace azurite
     // get archive item:
     aux::bytes get( LPCWSTR path ) {
       LPCBYTE pb = 0; UINT blen = 0;
-      if( aux::chars_of(path).like(WSTR("//*")))
+      static const aux::compiled_pattern<WCHAR> double_slash(WSTR("//*"));
+      if( double_slash.match(aux::chars_of(path)) )
         path += 2;
       SAPI()->AzuriteGetArchiveItem(har,path,&pb,&blen); return aux::bytes(pb,blen);
     }
@@ -136,7 +137,12 @@ namespace azurite
         LPCBYTE pb = 0; UINT cb = 0;
         aux::wchars wu = aux::chars_of(pnmld->uri);
 
-        if(wu.like(WSTR("res:*")))
+        enum { RES_URI, APP_URI };
+        static const WCHAR* const uri_patterns[] = { WSTR("res:*"), WSTR("this://app/*") };
+        static const aux::pattern_set<WCHAR> uri_routes(uri_patterns);
+        int route = uri_routes.match(wu);
+
+        if(route == RES_URI)
         {
           // then by calling possibly overloaded load_resource_data method
           if (static_cast<BASE*>(this)->load_resource_data(wu.start + 4, pb, cb))
@@ -151,7 +157,7 @@ namespace azurite
 #endif
             return LOAD_DISCARD;
           }
-        } else if(wu.like(WSTR("this://app/*"))) {
+        } else if(route == APP_URI) {
           // try to get them from archive first
           aux::bytes adata = archive::instance().get(wu.start+11);
           if (adata.length)
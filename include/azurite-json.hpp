@@ -0,0 +1,633 @@
+// Copyright(c) 2024  Case Technologies 
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __azurite_json_hpp__
+#define __azurite_json_hpp__
+
+/*
+ * Streaming JSON reader and writer working directly on UTF-8 bytes:
+ *
+ *   azurite::json_io::reader - incremental parser, accepts input in chunks split at arbitrary positions
+ *                           and builds value tree: arrays and maps are passed to the engine in one call each.
+ *   azurite::json_io::writer - serializes value into UTF-8 byte sink, no intermediate UTF-16 text.
+ *
+ *   value v = azurite::json_io::parse(bytes);              // v.is_error_string() on malformed input
+ *   pod::byte_buffer out; azurite::json_io::stringify(v, out);
+ */
+
+#include "azurite-types.h"
+#include "value.hpp"
+#include "aux-slice.h"
+#include "aux-cvt.h"
+#include <vector>
+#include <math.h>
+
+#if defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+namespace azurite
+{
+
+  namespace json_io
+  {
+
+    // first '"' or '\\' in [s, s + n), 0 if none
+    inline const BYTE* find_quote_or_escape(const BYTE* s, size_t n)
+    {
+#if defined(AUX_SSE2) || defined(AUX_NEON)
+      static const unsigned set[] = { '"', '\\' };
+      return aux::simd_find_any(s, n, set, 2);
+#else
+      for (const BYTE* e = s + n; s < e; ++s)
+        if (*s == '"' || *s == '\\') return s;
+      return 0;
+#endif
+    }
+
+    // index of first char that has to be escaped in JSON string: '"', '\\' or control char, n if none
+    inline size_t find_escapable(const WCHAR* s, size_t n)
+    {
+      size_t i = 0;
+#if defined(AUX_SSE2)
+      const __m128i quote = _mm_set1_epi16('"');
+      const __m128i bslash = _mm_set1_epi16('\\');
+      const __m128i ctl = _mm_set1_epi16(0x1F);
+      const __m128i zero = _mm_setzero_si128();
+      for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, quote), _mm_cmpeq_epi16(v, bslash)),
+                                 _mm_cmpeq_epi16(_mm_subs_epu16(v, ctl), zero)); // v <= 0x1F, unsigned
+        unsigned mask = unsigned(_mm_movemask_epi8(m));
+        if (mask) return i + aux::lowest_bit(mask) / 2;
+      }
+#elif defined(AUX_NEON)
+      typedef aux::simd_lanes<uint16_t> V;
+      const uint16x8_t quote = vdupq_n_u16('"');
+      const uint16x8_t bslash = vdupq_n_u16('\\');
+      const uint16x8_t ctl = vdupq_n_u16(0x1F);
+      for (; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16((const uint16_t*)(s + i));
+        uint64_t mask = V::mask(vorrq_u16(vorrq_u16(vceqq_u16(v, quote), vceqq_u16(v, bslash)), vcleq_u16(v, ctl)));
+        if (mask) return i + aux::lowest_bit(mask) / V::LANE_BITS;
+      }
+#endif
+      for (; i < n; ++i)
+        if (s[i] == '"' || s[i] == '\\' || s[i] < 0x20) return i;
+      return n;
+    }
+
+    // incremental JSON parser:
+    //
+    //   json_io::reader rd;
+    //   while( has_more_data ) if( rd.push(chunk) == json_io::reader::FAILED ) break;
+    //   if( rd.finish() == json_io::reader::DONE ) use(rd.result());
+    //
+    class reader
+    {
+    public:
+      enum status { NEED_MORE, DONE, FAILED };
+
+      reader(unsigned max_depth = 512): _max_depth(max_depth) { reset(); }
+
+      void reset()
+      {
+        _depth = 0;
+        _state = S_VALUE;
+        _token = TK_NONE;
+        _escape = false;
+        _key = false;
+        _start = 0;
+        _chunk = 0;
+        _offset = 0;
+        _error = 0;
+        _error_offset = 0;
+        _pending.clear();
+        _result = value();
+        for (size_t i = 0; i < _frames.size(); ++i) {
+          _frames[i].items.clear();
+          _frames[i].pairs.clear();
+        }
+      }
+
+      // feeds next portion of input, a chunk may end in the middle of any token
+      status push(aux::bytes chunk)
+      {
+        if (_state == S_FAILED) return FAILED;
+        const BYTE* p = chunk.start;
+        const BYTE* e = chunk.end();
+        _chunk = p;
+        if (_token != TK_NONE) _start = p; // continuation of the token
+        while (p < e)
+        {
+          if (_token == TK_STRING) { p = scan_string(p, e); continue; }
+          if (_token == TK_ATOM)   { p = scan_atom(p, e); continue; }
+
+          BYTE c = *p;
+          if (c == ' ' || c == '\n' || c == '\r' || c == '\t') { ++p; continue; }
+
+          switch (_state)
+          {
+            case S_FIRST_VALUE:
+              if (c == ']') { ++p; close(); continue; }
+              // fall through
+            case S_VALUE:
+              if (c == '{')      { open(true, p++); continue; }
+              else if (c == '[') { open(false, p++); continue; }
+              else if (c == '"') { ++p; _token = TK_STRING; _key = false; _start = p; continue; }
+              else if (is_atom_char(c)) { _token = TK_ATOM; _start = p; continue; }
+              break;
+            case S_FIRST_KEY:
+              if (c == '}') { ++p; close(); continue; }
+              // fall through
+            case S_KEY:
+              if (c == '"') { ++p; _token = TK_STRING; _key = true; _start = p; continue; }
+              break;
+            case S_COLON:
+              if (c == ':') { ++p; _state = S_VALUE; continue; }
+              break;
+            case S_NEXT:
+              if (c == ',') { ++p; _state = top().is_map ? S_KEY : S_VALUE; continue; }
+              if (c == (top().is_map ? '}' : ']')) { ++p; close(); continue; }
+              break;
+            default:
+              break;
+          }
+          if (_state != S_FAILED)
+            fail(_state == S_END ? "unexpected data after JSON value" : "unexpected character", p);
+          break;
+        }
+        if (_state == S_FAILED) return FAILED;
+        // partial token is kept across chunks
+        if (_token != TK_NONE && _start)
+          _pending.push(_start, size_t(e - _start));
+        _start = 0;
+        _chunk = 0;
+        _offset += chunk.length;
+        return _state == S_END ? DONE : NEED_MORE;
+      }
+
+      // signals end of input
+      status finish()
+      {
+        if (_state == S_FAILED) return FAILED;
+        if (_token == TK_ATOM) {
+          atom(aux::bytes(_pending.data(), _pending.length()), 0);
+          _pending.clear();
+          _token = TK_NONE;
+        }
+        if (_state == S_FAILED) return FAILED;
+        if (_state != S_END) { fail("unexpected end of input", 0); return FAILED; }
+        return DONE;
+      }
+
+      const value& result() const { return _result; }
+
+      // error message and offset of the error in the input, in bytes
+      const char* error() const { return _error; }
+      size_t      error_offset() const { return _error_offset; }
+
+    private:
+      enum state { S_VALUE, S_FIRST_VALUE, S_KEY, S_FIRST_KEY, S_COLON, S_NEXT, S_END, S_FAILED };
+      enum token { TK_NONE, TK_STRING, TK_ATOM };
+
+      // open array or map, elements are collected here and passed to the engine when it gets closed
+      struct frame
+      {
+        bool                                is_map;
+        std::vector<value>                  items;
+        std::vector<std::pair<value,value>> pairs;
+        value                               key;
+      };
+
+      std::vector<frame>  _frames; // grows to max depth seen, reused
+      size_t              _depth;
+      unsigned            _max_depth;
+      state               _state;
+      token               _token;
+      bool                _escape;  // last byte of previous chunk was '\\' inside string
+      bool                _key;     // current string is key
+      const BYTE*         _start;   // start of current token in current chunk
+      const BYTE*         _chunk;   // current chunk, for error offsets
+      pod::byte_buffer    _pending; // part of token from previous chunks
+      pod::wchar_buffer   _text;
+      value               _result;
+      size_t              _offset;
+      const char*         _error;
+      size_t              _error_offset;
+
+      frame& top() { return _frames[_depth - 1]; }
+
+      // moves content of src to dst without engine copy, src gets old content of dst
+      static void transfer(value& dst, value& src) { std::swap(*static_cast<VALUE*>(&dst), *static_cast<VALUE*>(&src)); }
+
+      static bool is_atom_char(BYTE c)
+      {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' || c == '.';
+      }
+
+      void fail(const char* msg, const BYTE* at)
+      {
+        _state = S_FAILED;
+        _error = msg;
+        _error_offset = _offset + (at && _chunk ? size_t(at - _chunk) : 0);
+      }
+
+      void open(bool is_map, const BYTE* at)
+      {
+        if (_depth >= _max_depth) { fail("maximum nesting depth exceeded", at); return; }
+        if (_frames.size() <= _depth) _frames.push_back(frame());
+        frame& f = _frames[_depth++];
+        f.is_map = is_map;
+        _state = is_map ? S_FIRST_KEY : S_FIRST_VALUE;
+      }
+
+      void close()
+      {
+        frame& f = _frames[--_depth];
+        if (f.is_map) {
+          value v = value::make_map();
+          if (f.pairs.size())
+            v.set_items(f.pairs.data(), unsigned(f.pairs.size()));
+          f.pairs.clear();
+          emit(v);
+        }
+        else {
+          value v = value::make_array(unsigned(f.items.size()), f.items.data());
+          f.items.clear();
+          emit(v);
+        }
+      }
+
+      void emit(value& v)
+      {
+        if (_depth == 0) {
+          transfer(_result, v);
+          _state = S_END;
+          return;
+        }
+        frame& f = top();
+        if (f.is_map)
+          f.pairs.push_back(std::pair<value,value>(std::move(f.key), std::move(v)));
+        else
+          f.items.push_back(std::move(v));
+        _state = S_NEXT;
+      }
+
+      const BYTE* scan_string(const BYTE* p, const BYTE* e)
+      {
+        if (_escape) { _escape = false; ++p; }
+        while (p < e)
+        {
+          const BYTE* q = find_quote_or_escape(p, size_t(e - p));
+          if (!q) return e;
+          if (*q == '\\') {
+            if (q + 1 == e) { _escape = true; return e; }
+            p = q + 2;
+            continue;
+          }
+          aux::bytes raw(_start, size_t(q - _start));
+          if (_pending.length()) {
+            _pending.push(raw.start, raw.length);
+            raw = aux::bytes(_pending.data(), _pending.length());
+          }
+          if (const char* err = decode_string(raw, _text))
+            fail(err, q);
+          else {
+            value s(aux::wchars(_text.data(), _text.length()));
+            if (_key) { transfer(top().key, s); _state = S_COLON; }
+            else emit(s);
+          }
+          _pending.clear();
+          _token = TK_NONE;
+          _start = 0;
+          return q + 1;
+        }
+        return p;
+      }
+
+      const BYTE* scan_atom(const BYTE* p, const BYTE* e)
+      {
+        while (p < e && is_atom_char(*p)) ++p;
+        if (p == e) return e;
+        aux::bytes raw(_start, size_t(p - _start));
+        if (_pending.length()) {
+          _pending.push(raw.start, raw.length);
+          raw = aux::bytes(_pending.data(), _pending.length());
+        }
+        atom(raw, p);
+        _pending.clear();
+        _token = TK_NONE;
+        _start = 0;
+        return p;
+      }
+
+      // number, true, false or null
+      void atom(aux::bytes raw, const BYTE* at)
+      {
+        value v;
+        aux::chars text((const char*)raw.start, raw.length);
+        if (text == aux::chars("true", 4)) ValueIntDataSet(&v, 1, T_BOOL, 0);
+        else if (text == aux::chars("false", 5)) ValueIntDataSet(&v, 0, T_BOOL, 0);
+        else if (text == aux::chars("null", 4)) v.t = T_NULL;
+        else if (!text.length || !(text[0] == '-' || (text[0] >= '0' && text[0] <= '9'))) { fail("invalid literal", at); return; }
+        else if (!is_number(text)) { fail("invalid number", at); return; }
+        else {
+          bool integer = true;
+          for (size_t i = 0; i < text.length && integer; ++i)
+            integer = text[i] != '.' && text[i] != 'e' && text[i] != 'E';
+          int64_t i64 = 0; double d = 0;
+          if (integer && aux::parse_int(text, i64) == text.length && i64 >= INT_MIN && i64 <= INT_MAX)
+            ValueIntDataSet(&v, INT(i64), T_INT, 0);
+          else if (aux::parse_double(text, d) == text.length && d == d && d != HUGE_VAL && d != -HUGE_VAL)
+            ValueFloatDataSet(&v, d, T_FLOAT, 0);
+          else { fail("invalid number", at); return; }
+        }
+        emit(v);
+      }
+
+      // strict JSON number: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+      static bool is_number(aux::chars t)
+      {
+        size_t i = 0, n = t.length;
+        if (i < n && t[i] == '-') ++i;
+        if (i == n) return false;
+        if (t[i] == '0') ++i; // no leading zeros
+        else if (t[i] >= '1' && t[i] <= '9') while (i < n && t[i] >= '0' && t[i] <= '9') ++i;
+        else return false;
+        if (i < n && t[i] == '.') {
+          size_t d = ++i;
+          while (i < n && t[i] >= '0' && t[i] <= '9') ++i;
+          if (i == d) return false;
+        }
+        if (i < n && (t[i] == 'e' || t[i] == 'E')) {
+          if (++i < n && (t[i] == '+' || t[i] == '-')) ++i;
+          size_t d = i;
+          while (i < n && t[i] >= '0' && t[i] <= '9') ++i;
+          if (i == d) return false;
+        }
+        return i == n;
+      }
+
+      static unsigned hex4(const BYTE* p)
+      {
+        unsigned r = 0;
+        for (int i = 0; i < 4; ++i) {
+          unsigned d = aux::digit_value(p[i]);
+          if (d > 15) return unsigned(-1);
+          r = (r << 4) | d;
+        }
+        return r;
+      }
+
+      // JSON string body (no quotes) -> UTF-16, returns error message or 0
+      static const char* decode_string(aux::bytes raw, pod::wchar_buffer& out)
+      {
+        out.clear();
+        const BYTE* p = raw.start;
+        const BYTE* e = raw.end();
+        while (p < e)
+        {
+          const BYTE* q = (const BYTE*)memchr(p, '\\', size_t(e - p));
+          if (!q) q = e;
+          if (q > p) {
+            for (const BYTE* c = p; c < q; ++c)
+              if (*c < 0x20) return "unescaped control character in string";
+            utf8::measure_sink<WCHAR> m(false);
+            if (utf8::decode(p, q, m, true)) return "invalid UTF-8";
+            utf8::fill_sink<WCHAR> f(out.append_uninitialized(m.n), false);
+            utf8::decode(p, q, f, true);
+          }
+          if (q == e) break;
+          if (++q == e) return "invalid escape sequence";
+          switch (*q++)
+          {
+            case '"':  out.push('"'); break;
+            case '\\': out.push('\\'); break;
+            case '/':  out.push('/'); break;
+            case 'b':  out.push('\b'); break;
+            case 'f':  out.push('\f'); break;
+            case 'n':  out.push('\n'); break;
+            case 'r':  out.push('\r'); break;
+            case 't':  out.push('\t'); break;
+            case 'u':
+              {
+                if (e - q < 4) return "invalid escape sequence";
+                unsigned u = hex4(q);
+                if (u > 0xFFFF) return "invalid escape sequence";
+                out.push(WCHAR(u)); // surrogates come as two escapes and are stored as is
+                q += 4;
+                break;
+              }
+            default: return "invalid escape sequence";
+          }
+          p = q;
+        }
+        return 0;
+      }
+    };
+
+    // parses complete UTF-8 JSON text, on failure returns error string (value::is_error_string())
+    inline value parse(aux::bytes text)
+    {
+      reader rd;
+      if (rd.push(text) == reader::FAILED || rd.finish() == reader::FAILED)
+        return value::make_error(rd.error());
+      return rd.result();
+    }
+
+    // JSON serializer, SINK is anything having
+    //   void push(BYTE c) and void push(const BYTE* pc, size_t sz)
+    // like pod::byte_buffer.
+    // indent > 0 produces multiline output with that many spaces per level.
+    template <class SINK>
+      class writer
+      {
+      public:
+        writer(SINK& out, unsigned indent = 0): _out(out), _indent(indent), _level(0) {}
+
+        void write(const value& v)
+        {
+          switch (v.t)
+          {
+            case T_UNDEFINED:
+            case T_NULL:
+              put("null", 4); return;
+            case T_BOOL:
+              if (v.get(false)) put("true", 4); else put("false", 5);
+              return;
+            case T_INT:
+              {
+                char buf[66];
+                put(buf, aux::format_int(buf, int64_t(v.get(0))));
+                return;
+              }
+            case T_FLOAT:
+              {
+                double d = v.get(0.0);
+                if (d != d || d == HUGE_VAL || d == -HUGE_VAL) { put("null", 4); return; } // no such things in JSON
+                char buf[32];
+                put(buf, aux::format_double(buf, d));
+                return;
+              }
+            case T_STRING:
+              write_string(v.get_chars()); return;
+            case T_ARRAY:
+              write_array(v); return;
+            case T_MAP:
+              write_map(v); return;
+            case T_OBJECT:
+              if (v.is_object_array()) write_array(v);
+              else if (v.is_object_function()) put("null", 4);
+              else write_map(v);
+              return;
+            case T_FUNCTION:
+              write_array(v); return; // named tuple, JSON has no place for its name
+            default:
+              {
+                // dates, lengths, colors, durations, etc. have no JSON counterpart - their text goes as string
+                string s = v.to_string();
+                write_string(aux::wchars(s.c_str(), s.length()));
+                return;
+              }
+          }
+        }
+
+        void write_string(aux::wchars s)
+        {
+          static const char hex[] = "0123456789abcdef";
+          _out.push(BYTE('"'));
+          while (s.length)
+          {
+            size_t n = find_escapable(s.start, s.length);
+            write_text(aux::wchars(s.start, n));
+            if (n == s.length) break;
+            WCHAR c = s.start[n];
+            switch (c)
+            {
+              case '"':  put("\\\"", 2); break;
+              case '\\': put("\\\\", 2); break;
+              case '\n': put("\\n", 2); break;
+              case '\r': put("\\r", 2); break;
+              case '\t': put("\\t", 2); break;
+              case '\b': put("\\b", 2); break;
+              case '\f': put("\\f", 2); break;
+              default:
+                {
+                  char u[6] = { '\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF] };
+                  put(u, 6);
+                }
+            }
+            s.prune(n + 1);
+          }
+          _out.push(BYTE('"'));
+        }
+
+      private:
+        SINK&    _out;
+        unsigned _indent;
+        unsigned _level;
+
+        void put(const char* s, size_t n) { _out.push((const BYTE*)s, n); }
+
+        // UTF-16 -> UTF-8 through small stack block
+        void write_text(aux::wchars s)
+        {
+          const size_t CHUNK = 256;
+          BYTE tmp[CHUNK * 3];
+          while (s.length)
+          {
+            size_t n = s.length > CHUNK ? CHUNK : s.length;
+            if (n < s.length && s.start[n - 1] >= 0xD800 && s.start[n - 1] <= 0xDBFF)
+              --n; // keep surrogate pair together
+            utf8::fill_sink<BYTE> f(tmp, false);
+            utf8::encode(aux::wchars(s.start, n), f, true);
+            _out.push(tmp, size_t(f.p - tmp));
+            s.prune(n);
+          }
+        }
+
+        void newline()
+        {
+          if (!_indent) return;
+          _out.push(BYTE('\n'));
+          for (unsigned i = 0; i < _level * _indent; ++i)
+            _out.push(BYTE(' '));
+        }
+
+        void write_array(const value& v)
+        {
+          int n = v.length();
+          _out.push(BYTE('['));
+          ++_level;
+          for (int i = 0; i < n; ++i) {
+            if (i) _out.push(BYTE(','));
+            newline();
+            write(v.get_item(i));
+          }
+          --_level;
+          if (n) newline();
+          _out.push(BYTE(']'));
+        }
+
+        // all key/value pairs in single ValueEnumElements pass
+        struct map_writer : value::enum_cb
+        {
+          writer& w;
+          bool    first;
+          map_writer(writer& wr): w(wr), first(true) {}
+          virtual bool on(const value& key, const value& val)
+          {
+            if (!first) w._out.push(BYTE(','));
+            first = false;
+            w.newline();
+            if (key.is_string()) w.write_string(key.get_chars());
+            else { string s = key.to_string(); w.write_string(aux::wchars(s.c_str(), s.length())); }
+            w._out.push(BYTE(':'));
+            if (w._indent) w._out.push(BYTE(' '));
+            w.write(val);
+            return true;
+          }
+        };
+
+        void write_map(const value& v)
+        {
+          _out.push(BYTE('{'));
+          ++_level;
+          map_writer mw(*this);
+          v.enum_elements(mw);
+          --_level;
+          if (!mw.first) newline();
+          _out.push(BYTE('}'));
+        }
+      };
+
+    // serializes value as UTF-8 JSON text appending it to out
+    inline void stringify(const value& v, pod::byte_buffer& out, unsigned indent = 0)
+    {
+      writer<pod::byte_buffer> w(out, indent);
+      w.write(v);
+    }
+
+  }
+
+}
+
+#endif //defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+#endif
@@ -0,0 +1,209 @@
+// Copyright(c) 2024  Case Technologies 
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __azurite_list_hpp__
+#define __azurite_list_hpp__
+
+/*
+ * Keyed list: keeps children of a container element in sync with an array of data items.
+ *
+ *   azurite::dom::keyed_list rows(table,
+ *     [](const value& item) { return dom::element::create("tr"); },                 // new row element
+ *     [](dom::batch& b, const dom::element& tr, const value& item) { ... });        // fill/patch row
+ *   rows.virtualize(24);   // optional: fixed row height, only rows in viewport get materialized
+ *   rows.update(items);    // on data change
+ *   rows.refresh();        // on scroll/resize of the container
+ *
+ * Rows are matched by item keys (item["key"] by default), elements are identified by their UIDs.
+ * Update makes minimal set of DOM changes: removes rows of vanished keys, keeps rows forming
+ * longest increasing subsequence of old positions in place, moves other kept rows,
+ * creates rows of new keys and patches rows of changed items - all applied by single dom::batch.
+ */
+
+#include "azurite-dom.hpp"
+#include "value.hpp"
+#include "aux-cvt.h"
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+#if defined(__cplusplus) && defined(CPP11) && !defined( PLAIN_API_ONLY )
+
+namespace azurite
+{
+
+  namespace dom
+  {
+
+    // positions of the longest strictly increasing subsequence of seq, elements < 0 are skipped
+    inline std::vector<size_t> longest_increasing_subsequence(const std::vector<int>& seq)
+    {
+      std::vector<size_t> tails;              // tails[k] - position of smallest tail of subsequence of length k+1
+      std::vector<size_t> prev(seq.size(), size_t(-1));
+      for (size_t i = 0; i < seq.size(); ++i) {
+        if (seq[i] < 0) continue;
+        size_t lo = 0, hi = tails.size();
+        while (lo < hi) {
+          size_t mid = (lo + hi) / 2;
+          if (seq[tails[mid]] < seq[i]) lo = mid + 1; else hi = mid;
+        }
+        if (lo) prev[i] = tails[lo - 1];
+        if (lo == tails.size()) tails.push_back(i); else tails[lo] = i;
+      }
+      std::vector<size_t> r(tails.size());
+      size_t p = tails.empty() ? size_t(-1) : tails.back();
+      for (size_t k = r.size(); k > 0; --k) { r[k - 1] = p; p = prev[p]; }
+      return r;
+    }
+
+    class keyed_list
+    {
+    public:
+      typedef std::function<azurite::string(const value& item)> key_fn;
+      typedef std::function<element(const value& item)> create_fn;  // shall return new, detached row element
+      typedef std::function<void(batch& b, const element& row, const value& item)> patch_fn; // fills row by item
+
+      keyed_list(const element& container, create_fn create, patch_fn patch, key_fn key = key_fn())
+        : _container(container), _create(create), _patch(patch), _key(key), _row_height(0), _overscan(0), _first(0)
+      {
+        if (!_key)
+          _key = [](const value& item) { return item.get_item("key").to_string(); };
+      }
+
+      // rows are row_height px high, only rows in the viewport and overscan rows before and after it are materialized,
+      // space of other rows is reserved by container's padding-top/bottom
+      void virtualize(int row_height, int overscan = 8) { _row_height = row_height; _overscan = overscan; }
+
+      // new data
+      void update(const value& items) { _items = items; refresh(); }
+
+      // reconciles materialized rows with the data, call it on scroll and resize of virtualized container
+      void refresh()
+      {
+        size_t total = size_t(_items.is_array_like() ? _items.length() : 0);
+        size_t first = 0, last = total;
+        if (_row_height > 0) {
+          POINT pos; RECT view; SIZE content;
+          _container.get_scroll_info(pos, view, content);
+          size_t visible = size_t((view.bottom - view.top + _row_height - 1) / _row_height);
+          size_t top = size_t(pos.y > 0 ? pos.y / _row_height : 0);
+          first = top > size_t(_overscan) ? top - _overscan : 0;
+          last = std::min(total, top + visible + _overscan);
+          if (first > last) first = last;
+        }
+        batch b;
+        reconcile(b, first, last);
+        if (_row_height > 0) {
+          b.set_style_attribute(_container, "padding-top", px(first * _row_height).c_str());
+          b.set_style_attribute(_container, "padding-bottom", px((total - last) * _row_height).c_str());
+        }
+        b.commit();
+      }
+
+      // index of the first materialized row, rows are children of the container starting from 0
+      size_t first_index() const { return _first; }
+      size_t materialized() const { return _rows.size(); }
+
+    private:
+      struct row {
+        azurite::string key;
+        UINT            uid;
+        value           item; // item the row was made/patched from
+      };
+
+      element         _container;
+      create_fn       _create;
+      patch_fn        _patch;
+      key_fn          _key;
+      value           _items;
+      int             _row_height;
+      int             _overscan;
+      size_t          _first;
+      std::vector<row> _rows; // materialized rows in DOM order
+
+      static azurite::string px(size_t v) { int n = int(v); aux::itow digits(n); azurite::string s(digits); s += WSTR("px"); return s; }
+
+      void reconcile(batch& b, size_t first, size_t last)
+      {
+        HWINDOW hwnd = _container.get_element_hwnd(true);
+
+        std::unordered_map<azurite::string, size_t> old_index;
+        old_index.reserve(_rows.size());
+        for (size_t j = 0; j < _rows.size(); ++j)
+          old_index[_rows[j].key] = j;
+
+        size_t n = last - first;
+        std::vector<row>     rows(n);
+        std::vector<int>     source(n, -1); // old position of the row or -1 if it is new
+        std::vector<element> els(n);
+        std::vector<bool>    used(_rows.size(), false);
+        for (size_t i = 0; i < n; ++i) {
+          rows[i].item = _items.get_item(int(first + i));
+          rows[i].key = _key(rows[i].item);
+          auto it = old_index.find(rows[i].key);
+          if (it == old_index.end() || used[it->second]) continue; // duplicate keys get new rows
+          element el = element::element_by_uid(hwnd, _rows[it->second].uid);
+          if (!el) continue; // removed by someone else
+          used[it->second] = true;
+          source[i] = int(it->second);
+          els[i] = el;
+        }
+
+        // vanished rows
+        for (size_t j = 0; j < _rows.size(); ++j)
+          if (!used[j])
+            if (element el = element::element_by_uid(hwnd, _rows[j].uid))
+              b.destroy(el);
+
+        // rows that stay in place, others get detached and inserted at new positions
+        std::vector<bool> stays(n, false);
+        std::vector<size_t> lis = longest_increasing_subsequence(source);
+        for (size_t k = 0; k < lis.size(); ++k) stays[lis[k]] = true;
+        for (size_t i = 0; i < n; ++i)
+          if (source[i] >= 0 && !stays[i])
+            b.detach(els[i]);
+
+        for (size_t i = 0; i < n; ++i) {
+          if (source[i] < 0) {
+            els[i] = _create(rows[i].item);
+            _patch(b, els[i], rows[i].item);
+            b.insert(_container, els[i], unsigned(i));
+          }
+          else {
+            const value& prev = _rows[size_t(source[i])].item;
+            if (!(prev == rows[i].item))
+              _patch(b, els[i], rows[i].item);
+            if (!stays[i])
+              b.insert(_container, els[i], unsigned(i));
+          }
+          rows[i].uid = els[i].get_element_uid();
+        }
+        _rows.swap(rows);
+        _first = first;
+      }
+    };
+
+  }
+
+}
+
+#endif
+
+#endif
@@ -28,6 +28,11 @@
 
 #ifdef __cplusplus
 #include <exception>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include "aux-intern.h"
 #endif
 
 #ifdef AZURITE_BUILD
@@ -49,13 +54,29 @@ typedef SBOOL(*som_any_prop_setter_t)(som_asset_t* thing, UINT64 propSymbol, con
 typedef SBOOL(*som_method_t)(som_asset_t* thing, UINT argc, const SOM_VALUE* argv, SOM_VALUE* p_result);
 typedef void(*som_dispose_t)(som_asset_t* thing);
 
+#ifdef __cplusplus
+namespace azurite {
+  namespace om {
+    // atom of the name, AzuriteAtomValue() gets called once per name in the process
+    inline som_atom_t atom(const char* name, uint64_t hash)
+    {
+      static aux::intern_table<som_atom_t> atoms;
+      const som_atom_t* pa = atoms.get(name, hash, [](const char* n, som_atom_t& a) { a = AzuriteAtomValue(n); });
+      return pa ? *pa : AzuriteAtomValue(name);
+    }
+    inline som_atom_t atom(const char* name) { return atom(name, aux::fnv1a(name)); }
+  }
+}
+#endif
+
 typedef struct som_property_def_t {
   void*             reserved;
   som_atom_t        name;
   som_prop_getter_t getter;
   som_prop_setter_t setter;
 #ifdef __cplusplus
-  som_property_def_t(const char* n, som_prop_getter_t pg, som_prop_setter_t ps = nullptr) : name(AzuriteAtomValue(n)), getter(pg), setter(ps) {}
+  som_property_def_t(const char* n, som_prop_getter_t pg, som_prop_setter_t ps = nullptr) : name(azurite::om::atom(n)), getter(pg), setter(ps) {}
+  som_property_def_t(const char* n, uint64_t hash, som_prop_getter_t pg, som_prop_setter_t ps = nullptr) : name(azurite::om::atom(n, hash)), getter(pg), setter(ps) {}
 #endif
 } som_property_def_t;
 
@@ -65,7 +86,8 @@ typedef struct som_method_def_t {
   size_t       params;
   som_method_t func;
 #ifdef __cplusplus
-  som_method_def_t(const char* n, size_t p, som_method_t f) : name(AzuriteAtomValue(n)), params(p), func(f) {}
+  som_method_def_t(const char* n, size_t p, som_method_t f) : name(azurite::om::atom(n)), params(p), func(f) {}
+  som_method_def_t(const char* n, uint64_t hash, size_t p, som_method_t f) : name(azurite::om::atom(n, hash)), params(p), func(f) {}
 #endif
 } som_method_def_t;
 
@@ -91,33 +113,33 @@ typedef struct som_passport_t {
 
 #ifdef CPP11
 
-#define SOM_FUNC(name) som_method_def_t( #name,\
+#define SOM_FUNC(name) som_method_def_t( #name, AUX_HASH(#name),\
     azurite::om::member_function<decltype(&TC::name)>::n_params,\
     &azurite::om::member_function<decltype(&TC::name)>::thunk<&TC::name> )
 
-#define SOM_FUNC_EX(ename,fname) som_method_def_t(#ename,\
+#define SOM_FUNC_EX(ename,fname) som_method_def_t(#ename, AUX_HASH(#ename),\
     azurite::om::member_function<decltype(&TC::fname)>::n_params, \
     &azurite::om::member_function<decltype(&TC::fname)>::thunk<&TC::fname> )
 
-#define SOM_PROP(name) som_property_def_t(#name,\
+#define SOM_PROP(name) som_property_def_t(#name, AUX_HASH(#name),\
     &azurite::om::member_property<TC,decltype(TC::name),&TC::name>::getter,\
     &azurite::om::member_property<TC,decltype(TC::name),&TC::name>::setter)
 
-#define SOM_PROP_EX(ename,pname) som_property_def_t(#ename,\
+#define SOM_PROP_EX(ename,pname) som_property_def_t(#ename, AUX_HASH(#ename),\
     &azurite::om::member_property<TC,decltype(TC::pname),&TC::pname>::getter,\
     &azurite::om::member_property<TC,decltype(TC::pname),&TC::pname>::setter)
 
-#define SOM_RO_PROP(name) som_property_def_t(#name, \
+#define SOM_RO_PROP(name) som_property_def_t(#name, AUX_HASH(#name), \
     &azurite::om::member_property<TC,decltype(TC::name),&TC::name>::getter)
 
-#define SOM_RO_PROP_EX(ename,pname) som_property_def_t(#ename, \
+#define SOM_RO_PROP_EX(ename,pname) som_property_def_t(#ename, AUX_HASH(#ename), \
     &azurite::om::member_property<TC,decltype(TC::pname),&TC::pname>::getter)
 
-#define SOM_VIRTUAL_PROP(name,prop_getter,prop_setter) som_property_def_t(#name, \
+#define SOM_VIRTUAL_PROP(name,prop_getter,prop_setter) som_property_def_t(#name, AUX_HASH(#name), \
     &azurite::om::member_getter_function<decltype(&TC::prop_getter)>::thunk<&TC::prop_getter>,\
     &azurite::om::member_setter_function<decltype(&TC::prop_setter)>::thunk<&TC::prop_setter>)
 
-#define SOM_RO_VIRTUAL_PROP(name,prop_getter) som_property_def_t(#name, \
+#define SOM_RO_VIRTUAL_PROP(name,prop_getter) som_property_def_t(#name, AUX_HASH(#name), \
     &azurite::om::member_getter_function<decltype(&TC::prop_getter)>::thunk<&TC::prop_getter>)
 
 #define SOM_ITEM_SET(func) \
@@ -141,16 +163,18 @@ typedef struct som_passport_t {
    som_passport_t* asset_get_passport() const override { \
      typedef classname TC; \
      static som_passport_t st = {}; \
-     st.name = AzuriteAtomValue(#classname); \
+     st.name = azurite::om::atom(#classname, AUX_HASH(#classname)); \
 
 #define SOM_PASSPORT_BEGIN_EX(exname, classname) \
    static const char* interface_name() { return #exname; } \
    som_passport_t* asset_get_passport() const override { \
      typedef classname TC; \
      static som_passport_t st = {}; \
-     st.name = AzuriteAtomValue(#exname); \
+     st.name = azurite::om::atom(#exname, AUX_HASH(#exname)); \
 
+// atom index of the passport gets built once, on first call
 #define SOM_PASSPORT_END \
+     static const bool indexed = azurite::om::passport_index::add(&st); (void)indexed; \
      return &st; \
    }
 
@@ -577,10 +601,149 @@ namespace azurite {
         }
       };
 
+      // index of SOM_PASSPORT_BEGIN/END passport: properties and methods sorted by atom
+      // plus names of properties, built once per class.
+      // som_passport_t is shared with the engine so indexes are kept aside, in the registry
+      // keyed by passport address: lock-free open addressing, append only as passports are static.
+      struct passport_index
+      {
+        struct entry {
+          som_atom_t name;
+          size_t     index;
+          bool operator < (const entry& rs) const { return name < rs.name; }
+          bool operator < (som_atom_t rs) const { return name < rs; }
+        };
+        std::vector<entry>       prop_index;
+        std::vector<entry>       method_index;
+        std::vector<std::string> prop_names; // in properties[] order
+
+        explicit passport_index(const som_passport_t& psp) {
+          prop_index.resize(psp.n_properties);
+          prop_names.resize(psp.n_properties);
+          for (size_t n = 0; n < psp.n_properties; ++n) {
+            prop_index[n].name = psp.properties[n].name;
+            prop_index[n].index = n;
+            prop_names[n] = atom_name(psp.properties[n].name);
+          }
+          std::sort(prop_index.begin(), prop_index.end());
+          method_index.resize(psp.n_methods);
+          for (size_t n = 0; n < psp.n_methods; ++n) {
+            method_index[n].name = psp.methods[n].name;
+            method_index[n].index = n;
+          }
+          std::sort(method_index.begin(), method_index.end());
+        }
+
+        // builds and registers index of the passport, false if the registry is full
+        static bool add(const som_passport_t* psp) {
+          const passport_index* pi = new passport_index(*psp); // lives forever, as the passport
+          for (unsigned i = 0, at = slot_of(psp); i < CAPACITY; ++i, at = (at + 1) % CAPACITY) {
+            slot& s = slots()[at];
+            const som_passport_t* expected = nullptr;
+            if (s.key.compare_exchange_strong(expected, psp, std::memory_order_acq_rel) || expected == psp) {
+              s.index.store(pi, std::memory_order_release);
+              return true;
+            }
+          }
+          delete pi;
+          return false;
+        }
+
+        // index of the passport or nullptr if it is not registered (or is being registered)
+        static const passport_index* of(const som_passport_t* psp) {
+          if (!psp) return nullptr;
+          for (unsigned i = 0, at = slot_of(psp); i < CAPACITY; ++i, at = (at + 1) % CAPACITY) {
+            slot& s = slots()[at];
+            const som_passport_t* key = s.key.load(std::memory_order_acquire);
+            if (!key) return nullptr;
+            if (key == psp) return s.index.load(std::memory_order_acquire);
+          }
+          return nullptr;
+        }
+
+        static const entry* find(const std::vector<entry>& index, som_atom_t name) {
+          auto it = std::lower_bound(index.begin(), index.end(), name);
+          return it != index.end() && it->name == name ? &*it : nullptr;
+        }
+
+      private:
+        enum { CAPACITY = 1024 };
+        struct slot {
+          std::atomic<const som_passport_t*> key;
+          std::atomic<const passport_index*> index;
+        };
+        static slot* slots() { static slot table[CAPACITY]; return table; } // zero initialized
+        static unsigned slot_of(const som_passport_t* psp) { return unsigned((uintptr_t(psp) >> 4) % CAPACITY); }
+      };
+
+      // property definition by atom: binary search in indexed passports, linear in others
+      inline const som_property_def_t* find_property(const som_passport_t* psp, som_atom_t name) {
+        if (!psp) return nullptr;
+        if (const passport_index* pp = passport_index::of(psp)) {
+          const passport_index::entry* pe = passport_index::find(pp->prop_index, name);
+          return pe ? &psp->properties[pe->index] : nullptr;
+        }
+        for (size_t n = 0; n < psp->n_properties; ++n)
+          if (psp->properties[n].name == name) return &psp->properties[n];
+        return nullptr;
+      }
+
+      // method definition by atom, as above
+      inline const som_method_def_t* find_method(const som_passport_t* psp, som_atom_t name) {
+        if (!psp) return nullptr;
+        if (const passport_index* pp = passport_index::of(psp)) {
+          const passport_index::entry* pe = passport_index::find(pp->method_index, name);
+          return pe ? &psp->methods[pe->index] : nullptr;
+        }
+        for (size_t n = 0; n < psp->n_methods; ++n)
+          if (psp->methods[n].name == name) return &psp->methods[n];
+        return nullptr;
+      }
+
+      // reads n properties, values[i] = asset.names[i], returns number of properties read,
+      // values of unknown properties are left intact
+      inline size_t get_properties(som_asset_t* ptr, const som_atom_t* names, size_t n, SOM_VALUE* values) {
+        som_passport_t* psp = asset_get_passport(ptr);
+        size_t got = 0;
+        for (size_t i = 0; i < n; ++i) {
+          const som_property_def_t* pd = find_property(psp, names[i]);
+          if (pd && pd->getter && pd->getter(ptr, &values[i])) ++got;
+        }
+        return got;
+      }
+
+      // asset.names[i] = values[i], returns number of properties set, read-only and unknown properties are skipped
+      inline size_t set_properties(som_asset_t* ptr, const som_atom_t* names, const SOM_VALUE* values, size_t n) {
+        som_passport_t* psp = asset_get_passport(ptr);
+        size_t set = 0;
+        for (size_t i = 0; i < n; ++i) {
+          const som_property_def_t* pd = find_property(psp, names[i]);
+          if (pd && pd->setter && pd->setter(ptr, &values[i])) ++set;
+        }
+        return set;
+      }
+
       // returns pack of asset's properties as a map
       inline SOM_VALUE asset_to_map(som_asset_t *ptr) {
         if (auto psp = asset_get_passport(ptr)) {
           SOM_VALUE map;
+#ifndef AZURITE_BUILD
+          if (const passport_index* pp = passport_index::of(psp)) { // names are known, map is made in one call
+            std::vector< std::pair<SOM_VALUE, SOM_VALUE> > items;
+            items.reserve(psp->n_properties);
+            for (size_t n = 0; n < psp->n_properties; ++n) {
+              SOM_VALUE val;
+              if (!psp->properties[n].getter(ptr, &val)) continue;
+              const char* name = pp->prop_names[n].c_str();
+              const SOM_VALUE* pkey = intern_symbol(name); // same keys as set_item(name) makes
+              items.push_back(std::make_pair(pkey ? *pkey : SOM_VALUE(name), std::move(val)));
+            }
+            map = SOM_VALUE::make_map();
+            if (items.size())
+              map.set_items(items.data(), unsigned(items.size()));
+            return map;
+          }
+#endif
           for (size_t n = 0; n < psp->n_properties; ++n) {
             SOM_VALUE val;
             if (psp->properties[n].getter(ptr, &val))
@@ -591,6 +754,20 @@ namespace azurite {
         return SOM_VALUE();
       }
 
+      // sets writable properties of the asset from the map, returns number of properties set
+      inline size_t asset_from_map(som_asset_t *ptr, const SOM_VALUE& map) {
+        size_t set = 0;
+        if (auto psp = asset_get_passport(ptr)) {
+          const passport_index* pp = passport_index::of(psp);
+          for (size_t n = 0; n < psp->n_properties; ++n) {
+            if (!psp->properties[n].setter) continue;
+            SOM_VALUE val = pp ? map.get_item(pp->prop_names[n].c_str()) : map.get_item(atom_name(psp->properties[n].name).c_str());
+            if (!val.is_undefined() && psp->properties[n].setter(ptr, &val)) ++set;
+          }
+        }
+        return set;
+      }
+
   }
 }
 
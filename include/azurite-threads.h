@@ -21,6 +21,8 @@
 #if !defined(__AZURITE_THREADS_H__)
 #define __AZURITE_THREADS_H__
 
+#include "azurite-types.h"
+
 #if defined(WINDOWS)
   #include <specstrings.h>
   #include <windows.h>
@@ -38,6 +40,7 @@
 
     namespace sync {
 
+      // recursive, see fast_mutex for the lightweight non-recursive one
       class mutex
       {
         CRITICAL_SECTION cs;
@@ -48,19 +51,14 @@
         ~mutex()        { DeleteCriticalSection(&cs); }
       };
 
-      class critical_section {
-        mutex& m;
-      public:
-        critical_section(mutex& guard) : m(guard) { m.lock(); }
-        ~critical_section() { m.unlock(); }
-      };
-
+      // auto-reset event releases one waiter and resets itself, manual-reset one stays signaled until reset()
       struct event
       {
         HANDLE h;
-        event()       { h = CreateEvent(NULL, FALSE, FALSE, NULL);  }
+        event(bool manual_reset = false) { h = CreateEvent(NULL, manual_reset, FALSE, NULL);  }
         ~event()      { CloseHandle(h); }
         void signal()                   { SetEvent(h); }
+        void reset()                    { ResetEvent(h); }
         bool wait(unsigned int ms = INFINITE)   { return WaitForSingleObject(h, ms) == WAIT_OBJECT_0; }
       private:
         event( const event& );
@@ -70,68 +68,6 @@
       inline void yield() { Sleep(0); }
       inline void sleep(unsigned ms) { Sleep(ms); }
 
-      class gui_thread_ctx
-      {
-        HHOOK _hook;
-
-        typedef std::function<void(void)> gui_block;
-
-        static DWORD thread_id()
-        {
-          static DWORD _thread_id = ::GetCurrentThreadId();
-          return _thread_id;
-        }
-        static UINT message()
-        {
-          static UINT _message = ::RegisterWindowMessage( TEXT("GUI-THREAD-EXEC_RQ"));
-          return _message;
-        }
-
-        void install_hook()
-        {
-          message(); // force message to be registered
-          // setup the WH_GETMESSAGE hook.
-          // Using hooks here allows this mechanism to work even under modal dialogs.
-          _hook = ::SetWindowsHookEx(WH_GETMESSAGE,&exec_hook,THIS_HINSTANCE, thread_id());
-        }
-        void release_hook()
-        {
-          if(_hook)  ::UnhookWindowsHookEx(_hook);
-        }
-
-        // message hook to handle WM_EXEC in GUI thread
-        static LRESULT CALLBACK exec_hook(int code, WPARAM wParam, LPARAM lParam )
-        {
-          MSG* pmsg = reinterpret_cast<MSG*>(lParam);
-          if(wParam == PM_REMOVE && pmsg->message == message())
-          {
-            event* pe = reinterpret_cast<azurite::sync::event*>(pmsg->wParam);
-            gui_block* pf = reinterpret_cast<gui_block*>(pmsg->lParam);
-            (*pf)();      // execute the block in this GUI thread
-            pe->signal(); // signal that we've done with it
-                          // this will resume execution of worker thread.
-          }
-          return CallNextHookEx(0,code, wParam,lParam);
-        }
-
-      public:
-        gui_thread_ctx() { install_hook(); }
-        ~gui_thread_ctx() { release_hook(); }
-
-        // this function is called from worker threads to
-        // execute the gui_block in GUI thread
-        static void exec( gui_block code )
-        {
-          event evt;
-          PostThreadMessage(thread_id(), message(), WPARAM(&evt),LPARAM(&code));
-          evt.wait(); // suspend worker thread until GUI will execute the block.
-        }
-
-      };
-
-      #define GUI_CODE_START azurite::sync::gui_thread_ctx::exec([&]() {
-      #define GUI_CODE_END });
-
     }
 
     template<typename F, typename P>
@@ -184,9 +120,9 @@
 
     namespace sync {
 
+      // recursive, see fast_mutex for the lightweight non-recursive one
       class mutex :public std::recursive_mutex
       {
-          friend class event;
           typedef std::recursive_mutex super;
           mutex( const mutex& ) = delete;
           mutex& operator=(const mutex&) = delete;
@@ -196,42 +132,46 @@
           //void unlock() { super::unlock(); }
       };
 
-      class critical_section: public std::lock_guard<mutex>
-      {
-          typedef std::lock_guard<mutex> super;
-          critical_section(const critical_section& rs) = delete;
-          critical_section& operator=(const critical_section&) = delete;
-
-      public:
-          critical_section(mutex& m) : super(m) {}
-          ~critical_section() {}
-      };
-
+      // auto-reset event releases one waiter and resets itself, manual-reset one stays signaled until reset().
+      // The state is stored so signal() before wait() is not lost.
       class event
       {
-        //typedef std::condition_variable super;
         event( const event& ) = delete;
         event& operator=(const event&) = delete;
 
-        std::condition_variable_any _var;
-        std::mutex                  _mtx;
+        std::mutex              _mtx;
+        std::condition_variable _var;
+        bool                    _signaled;
+        bool                    _manual_reset;
       public:
-        event() {}
+        event(bool manual_reset = false) : _signaled(false), _manual_reset(manual_reset) {}
         void signal() {
+          {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _signaled = true;
+          }
+          if (_manual_reset)
+            _var.notify_all();
+          else
             _var.notify_one();
         }
-        void wait(mutex& m) {
-           std::unique_lock<mutex> lock(m);
-           _var.wait(lock);
+        void reset() {
+          std::lock_guard<std::mutex> lock(_mtx);
+          _signaled = false;
         }
-        void wait(unsigned int ms = unsigned(-1)) {
-            std::unique_lock<std::mutex> lock(_mtx);
-            if( ms == unsigned(-1) )
-              _var.wait(lock);
-            else
-              _var.wait_for(lock, std::chrono::milliseconds(ms));
+        bool wait(unsigned int ms = unsigned(-1)) {
+          std::unique_lock<std::mutex> lock(_mtx);
+          auto is_signaled = [this]() { return _signaled; };
+          if (ms == unsigned(-1))
+            _var.wait(lock, is_signaled);
+          else if (!_var.wait_for(lock, std::chrono::milliseconds(ms), is_signaled))
+            return false;
+          if (!_manual_reset)
+            _signaled = false;
+          return true;
         }
-
+        // kept for compatibility, the event does not need external mutex any more
+        bool wait(mutex&) { return wait(); }
       };
 
       inline void sleep(uint ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
@@ -248,4 +188,1063 @@
 
 #endif
 
+
+// common for all platforms: lightweight sync primitives, thread pool, GUI thread queue
+
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#if defined(OSX) && !defined(WINDOWLESS)
+  #include <dispatch/dispatch.h>
+#endif
+#if defined(LINUX)
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+  #include <limits.h>
+#elif defined(OSX)
+  #include <os/lock.h>
+#endif
+#if !defined(WINDOWS)
+  #include <pthread.h>
+#endif
+
+namespace azurite {
+
+  namespace sync {
+
+    // pause instruction for spin-wait loops
+    inline void cpu_relax()
+    {
+#if defined(WINDOWS)
+      YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      __asm__ __volatile__("yield");
+#endif
+    }
+
+#if defined(LINUX)
+    inline void futex_wait(std::atomic<int>* addr, int expected) {
+      syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+    inline void futex_wake(std::atomic<int>* addr, int n) {
+      syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+    }
+#endif
+
+    // Non-recursive lightweight mutex: spins shortly and then parks the thread in the kernel.
+    // Uncontended lock/unlock is a single atomic operation.
+    // Windows - SRWLOCK, Linux - futex, OSX - os_unfair_lock.
+    class fast_mutex
+    {
+      enum { SPIN_COUNT = 100 };
+#if defined(WINDOWS)
+      SRWLOCK _lock;
+    public:
+      fast_mutex() { InitializeSRWLock(&_lock); }
+      bool try_lock() { return TryAcquireSRWLockExclusive(&_lock) != FALSE; }
+      void lock() {
+        for (int n = 0; n < SPIN_COUNT; ++n) {
+          if (try_lock()) return;
+          cpu_relax();
+        }
+        AcquireSRWLockExclusive(&_lock);
+      }
+      void unlock() { ReleaseSRWLockExclusive(&_lock); }
+#elif defined(LINUX)
+      std::atomic<int> _state; // 0 - free, 1 - locked, 2 - locked and there are (maybe) waiters
+    public:
+      fast_mutex() : _state(0) {}
+      bool try_lock() {
+        int c = 0;
+        return _state.compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed);
+      }
+      void lock() {
+        for (int n = 0; n < SPIN_COUNT; ++n) {
+          if (_state.load(std::memory_order_relaxed) == 0 && try_lock()) return;
+          cpu_relax();
+        }
+        // see "Futexes Are Tricky", U.Drepper, mutex #3
+        int c = _state.exchange(2, std::memory_order_acquire);
+        while (c != 0) {
+          futex_wait(&_state, 2);
+          c = _state.exchange(2, std::memory_order_acquire);
+        }
+      }
+      void unlock() {
+        if (_state.exchange(0, std::memory_order_release) == 2)
+          futex_wake(&_state, 1);
+      }
+#elif defined(OSX)
+      os_unfair_lock _lock;
+    public:
+      fast_mutex() : _lock(OS_UNFAIR_LOCK_INIT) {}
+      bool try_lock() { return os_unfair_lock_trylock(&_lock); }
+      void lock() {
+        for (int n = 0; n < SPIN_COUNT; ++n) {
+          if (try_lock()) return;
+          cpu_relax();
+        }
+        os_unfair_lock_lock(&_lock);
+      }
+      void unlock() { os_unfair_lock_unlock(&_lock); }
+#else
+      std::mutex _lock;
+    public:
+      fast_mutex() {}
+      bool try_lock() { return _lock.try_lock(); }
+      void lock() {
+        for (int n = 0; n < SPIN_COUNT; ++n) {
+          if (try_lock()) return;
+          cpu_relax();
+        }
+        _lock.lock();
+      }
+      void unlock() { _lock.unlock(); }
+#endif
+    private:
+      fast_mutex(const fast_mutex&);
+      fast_mutex& operator=(const fast_mutex&);
+    };
+
+    // reader-writer lock, many readers or one writer, non-recursive
+    class rw_lock
+    {
+#if defined(WINDOWS)
+      SRWLOCK _lock;
+    public:
+      rw_lock()  { InitializeSRWLock(&_lock); }
+      void lock()             { AcquireSRWLockExclusive(&_lock); }
+      bool try_lock()         { return TryAcquireSRWLockExclusive(&_lock) != FALSE; }
+      void unlock()           { ReleaseSRWLockExclusive(&_lock); }
+      void lock_shared()      { AcquireSRWLockShared(&_lock); }
+      bool try_lock_shared()  { return TryAcquireSRWLockShared(&_lock) != FALSE; }
+      void unlock_shared()    { ReleaseSRWLockShared(&_lock); }
+#else
+      pthread_rwlock_t _lock;
+    public:
+      rw_lock()  { pthread_rwlock_init(&_lock, nullptr); }
+      ~rw_lock() { pthread_rwlock_destroy(&_lock); }
+      void lock()             { int r = pthread_rwlock_wrlock(&_lock); assert(r == 0); (void)r; }
+      bool try_lock()         { return pthread_rwlock_trywrlock(&_lock) == 0; }
+      void unlock()           { pthread_rwlock_unlock(&_lock); }
+      void lock_shared()      { int r = pthread_rwlock_rdlock(&_lock); assert(r == 0); (void)r; }
+      bool try_lock_shared()  { return pthread_rwlock_tryrdlock(&_lock) == 0; }
+      void unlock_shared()    { pthread_rwlock_unlock(&_lock); }
+#endif
+    private:
+      rw_lock(const rw_lock&);
+      rw_lock& operator=(const rw_lock&);
+    };
+
+    // counting semaphore
+    class semaphore
+    {
+#if defined(WINDOWS)
+      HANDLE _h;
+    public:
+      semaphore(unsigned initial = 0) { _h = CreateSemaphore(NULL, LONG(initial), LONG_MAX, NULL); }
+      ~semaphore() { CloseHandle(_h); }
+      void signal(unsigned n = 1)           { ReleaseSemaphore(_h, LONG(n), NULL); }
+      bool try_wait()                       { return WaitForSingleObject(_h, 0) == WAIT_OBJECT_0; }
+      bool wait(unsigned int ms = INFINITE) { return WaitForSingleObject(_h, ms) == WAIT_OBJECT_0; }
+#else
+      std::atomic<int>        _count;
+      std::atomic<int>        _waiters;
+      std::mutex              _mtx;
+      std::condition_variable _var;
+    public:
+      semaphore(unsigned initial = 0) : _count(int(initial)), _waiters(0) {}
+      void signal(unsigned n = 1) {
+        _count.fetch_add(int(n));
+        if (_waiters.load() == 0)
+          return;
+        { std::lock_guard<std::mutex> lock(_mtx); }
+        if (n == 1)
+          _var.notify_one();
+        else
+          _var.notify_all();
+      }
+      // _count and _waiters are accessed seq_cst: waiter does ++_waiters then reads _count,
+      // signal() does _count += n then reads _waiters - at least one of them sees the other's store,
+      // so a waiter never sleeps on a count that signal() decided nobody waits for
+      bool try_wait() {
+        int c = _count.load();
+        while (c > 0)
+          if (_count.compare_exchange_weak(c, c - 1))
+            return true;
+        return false;
+      }
+      bool wait(unsigned int ms = unsigned(-1)) {
+        if (try_wait())
+          return true;
+        std::unique_lock<std::mutex> lock(_mtx);
+        ++_waiters;
+        auto acquired = [this]() { return try_wait(); };
+        bool r = true;
+        if (ms == unsigned(-1))
+          _var.wait(lock, acquired);
+        else
+          r = _var.wait_for(lock, std::chrono::milliseconds(ms), acquired);
+        --_waiters;
+        return r;
+      }
+#endif
+    private:
+      semaphore(const semaphore&);
+      semaphore& operator=(const semaphore&);
+    };
+
+    // guards, L is any of mutex, fast_mutex, rw_lock
+    template<typename L>
+    class scoped_lock
+    {
+      L& _l;
+      scoped_lock(const scoped_lock&);
+      scoped_lock& operator=(const scoped_lock&);
+    public:
+      scoped_lock(L& l) : _l(l) { _l.lock(); }
+      ~scoped_lock() { _l.unlock(); }
+    };
+
+    template<typename L>
+    class scoped_shared_lock
+    {
+      L& _l;
+      scoped_shared_lock(const scoped_shared_lock&);
+      scoped_shared_lock& operator=(const scoped_shared_lock&);
+    public:
+      scoped_shared_lock(L& l) : _l(l) { _l.lock_shared(); }
+      ~scoped_shared_lock() { _l.unlock_shared(); }
+    };
+
+    class critical_section
+    {
+      mutex*      _m;
+      fast_mutex* _fm;
+      critical_section(const critical_section&);
+      critical_section& operator=(const critical_section&);
+    public:
+      critical_section(mutex& m) : _m(&m), _fm(nullptr) { m.lock(); }
+      critical_section(fast_mutex& m) : _m(nullptr), _fm(&m) { m.lock(); }
+      ~critical_section() { if (_m) _m->unlock(); else _fm->unlock(); }
+    };
+
+    enum task_priority {
+      PRIORITY_HIGH   = 0,
+      PRIORITY_NORMAL = 1,
+      PRIORITY_LOW    = 2,
+      PRIORITY_COUNT  = 3,
+    };
+
+    class thread_pool;
+    class gui_queue;
+    template<typename R> class task_future;
+
+    // thrown by task_future::get() when the task was dropped without running,
+    // e.g. delayed task of a pool that is being destroyed
+    struct task_cancelled : public std::runtime_error {
+      task_cancelled() : std::runtime_error("task cancelled") {}
+    };
+
+    // unit of work queued in thread_pool
+    struct pool_task
+    {
+      pool_task* next; // link in intrusive queues
+      pool_task() : next(nullptr) {}
+      virtual ~pool_task() {}
+      virtual void run() = 0;
+      virtual void cancel() {}
+    };
+
+    template<typename F>
+    struct function_task : public pool_task
+    {
+      F f;
+      function_task(F&& fn) : f(std::move(fn)) {}
+      virtual void run() { f(); }
+    };
+
+    // Chase-Lev work stealing deque, see
+    // "Correct and Efficient Work-Stealing for Weak Memory Models", Le, Pop, Cohen, Nardelli, 2013.
+    // push() and pop() are called by the owning worker only, steal() - by any thread.
+    class work_deque
+    {
+      struct ring {
+        int64_t                   mask;
+        std::atomic<pool_task*>*  slots;
+        ring*                     retired; // previous (smaller) ring, thieves may still read it
+        ring(int64_t capacity, ring* prev) : mask(capacity - 1), slots(new std::atomic<pool_task*>[size_t(capacity)]), retired(prev) {}
+        ~ring() { delete[] slots; }
+        int64_t    capacity() const           { return mask + 1; }
+        pool_task* get(int64_t i) const       { return slots[i & mask].load(std::memory_order_relaxed); }
+        void       put(int64_t i, pool_task* t) { slots[i & mask].store(t, std::memory_order_relaxed); }
+      };
+
+      std::atomic<int64_t> _top;
+      char                 _pad1[64 - sizeof(std::atomic<int64_t>)]; // keep thieves and owner on different cache lines
+      std::atomic<int64_t> _bottom;
+      char                 _pad2[64 - sizeof(std::atomic<int64_t>)];
+      std::atomic<ring*>   _ring;
+
+      work_deque(const work_deque&);
+      work_deque& operator=(const work_deque&);
+    public:
+      work_deque() : _top(0), _bottom(0), _ring(new ring(64, nullptr)) {}
+      ~work_deque() {
+        ring* r = _ring.load(std::memory_order_relaxed);
+        while (r) { ring* prev = r->retired; delete r; r = prev; }
+      }
+
+      bool empty() const {
+        return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+      }
+
+      void push(pool_task* t)
+      {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t tp = _top.load(std::memory_order_acquire);
+        ring* r = _ring.load(std::memory_order_relaxed);
+        if (b - tp > r->capacity() - 1) {
+          ring* nr = new ring(r->capacity() * 2, r);
+          for (int64_t i = tp; i < b; ++i)
+            nr->put(i, r->get(i));
+          _ring.store(nr, std::memory_order_release);
+          r = nr;
+        }
+        r->put(b, t);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+      }
+
+      pool_task* pop()
+      {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        ring* r = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t tp = _top.load(std::memory_order_relaxed);
+        if (tp > b) { // empty
+          _bottom.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+        pool_task* t = r->get(b);
+        if (tp == b) { // last one, race with thieves
+          if (!_top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            t = nullptr;
+          _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+      }
+
+      pool_task* steal()
+      {
+        int64_t tp = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (tp >= b)
+          return nullptr;
+        ring* r = _ring.load(std::memory_order_acquire);
+        pool_task* t = r->get(tp);
+        if (!_top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+          return nullptr; // lost the race, caller will retry
+        return t;
+      }
+    };
+
+    // shared state of task_future
+    class future_state_base
+    {
+    protected:
+      std::mutex                          _mtx;
+      std::condition_variable             _cv;
+      bool                                _done;
+      std::exception_ptr                  _error;
+      std::vector<std::function<void()>>  _continuations;
+
+      // to be called with _mtx locked, after the result is stored
+      void finish(std::unique_lock<std::mutex>& lock) {
+        _done = true;
+        std::vector<std::function<void()>> continuations;
+        continuations.swap(_continuations);
+        lock.unlock();
+        _cv.notify_all();
+        for (size_t n = 0; n < continuations.size(); ++n)
+          continuations[n]();
+      }
+    public:
+      future_state_base() : _done(false) {}
+      virtual ~future_state_base() {}
+
+      bool ready() {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _done;
+      }
+      void wait() {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _cv.wait(lock, [this]() { return _done; });
+      }
+      bool wait_for(unsigned ms) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        return _cv.wait_for(lock, std::chrono::milliseconds(ms), [this]() { return _done; });
+      }
+      void set_error(std::exception_ptr e) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if (_done) return;
+        _error = e;
+        finish(lock);
+      }
+      std::exception_ptr error() const { return _error; } // valid after ready()
+      // calls f once the state is ready, immediately if it is ready already
+      void on_ready(std::function<void()> f) {
+        {
+          std::lock_guard<std::mutex> lock(_mtx);
+          if (!_done) { _continuations.push_back(std::move(f)); return; }
+        }
+        f();
+      }
+    };
+
+    template<typename R>
+    class future_state : public future_state_base
+    {
+      union { R _value; };
+      bool _has_value;
+    public:
+      future_state() : _has_value(false) {}
+      ~future_state() { if (_has_value) _value.~R(); }
+      void set_value(R&& v) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if (_done) return;
+        new (&_value) R(std::move(v));
+        _has_value = true;
+        finish(lock);
+      }
+      const R& value() const { return _value; }
+    };
+
+    template<>
+    class future_state<void> : public future_state_base
+    {
+    public:
+      void set_value() {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if (_done) return;
+        finish(lock);
+      }
+      void value() const {}
+    };
+
+    // runs f and stores its result or exception in the state
+    template<typename R, typename F>
+      inline void fulfil(future_state<R>& s, F& f) {
+        try { s.set_value(f()); }
+        catch (...) { s.set_error(std::current_exception()); }
+      }
+    template<typename F>
+      inline void fulfil(future_state<void>& s, F& f) {
+        try { f(); s.set_value(); }
+        catch (...) { s.set_error(std::current_exception()); }
+      }
+
+    // calls continuation with the result of the previous task
+    template<typename R>
+    struct continuation_call {
+      template<typename F> static auto call(F& f, const future_state<R>& s) -> decltype(f(s.value())) { return f(s.value()); }
+    };
+    template<>
+    struct continuation_call<void> {
+      template<typename F> static auto call(F& f, const future_state<void>&) -> decltype(f()) { return f(); }
+    };
+
+    template<typename R, typename F>
+    struct packaged_task : public pool_task
+    {
+      std::shared_ptr<future_state<R>> state;
+      F f;
+      packaged_task(const std::shared_ptr<future_state<R>>& s, F&& fn) : state(s), f(std::move(fn)) {}
+      virtual void run() { fulfil(*state, f); }
+      virtual void cancel() { state->set_error(std::make_exception_ptr(task_cancelled())); }
+    };
+
+    // Fixed set of worker threads executing pool_tasks.
+    // Each worker owns one Chase-Lev deque per priority: tasks submitted from
+    // a worker go to its own deque (LIFO, cache friendly), tasks submitted from other
+    // threads - to global per-priority queues. Idle workers steal from each other (FIFO).
+    // Higher priority work is always picked first.
+    // NOTE: tasks are expected to be short, a task that blocks forever (e.g. endless loop)
+    //       takes the worker out of the pool - use schedule() for periodic work instead.
+    class thread_pool
+    {
+      typedef std::chrono::steady_clock clock;
+
+      struct worker {
+        work_deque  deques[PRIORITY_COUNT];
+        std::thread thread;
+      };
+
+      struct timer {
+        clock::time_point due;
+        uint64_t          seq;
+        pool_task*        task;
+        task_priority     priority;
+        bool operator < (const timer& rs) const { // min-heap order
+          return due != rs.due ? due > rs.due : seq > rs.seq;
+        }
+      };
+
+      struct injection_queue {
+        fast_mutex              mtx;
+        std::deque<pool_task*>  tasks;
+        std::atomic<size_t>     size;
+        injection_queue() : size(0) {}
+      };
+
+      std::vector<worker*>    _workers;
+      injection_queue         _injected[PRIORITY_COUNT];
+      std::atomic<int>        _pending;   // number of queued but not yet taken tasks
+      std::atomic<int>        _sleepers;  // number of workers waiting on _idle
+      std::atomic<bool>       _stopping;
+
+      std::mutex              _idle_mtx;  // guards _timers too
+      std::condition_variable _idle;
+      std::vector<timer>      _timers;
+      uint64_t                _timer_seq;
+      std::atomic<int64_t>    _next_due;  // ticks of the earliest timer, INT64_MAX if none
+
+      struct worker_ctx { thread_pool* pool; unsigned index; };
+      static worker_ctx& current() {
+        static thread_local worker_ctx ctx = { nullptr, 0 };
+        return ctx;
+      }
+
+      thread_pool(const thread_pool&);
+      thread_pool& operator=(const thread_pool&);
+
+    public:
+
+      explicit thread_pool(unsigned nthreads = 0)
+        : _pending(0), _sleepers(0), _stopping(false), _timer_seq(0), _next_due(INT64_MAX)
+      {
+        if (nthreads == 0)
+          nthreads = default_size();
+        _workers.reserve(nthreads);
+        for (unsigned n = 0; n < nthreads; ++n)
+          _workers.push_back(new worker());
+        for (unsigned n = 0; n < nthreads; ++n)
+          _workers[n]->thread = std::thread(&thread_pool::worker_proc, this, n);
+      }
+
+      // waits for queued tasks to complete, delayed tasks that are not due yet get cancelled
+      ~thread_pool()
+      {
+        std::vector<timer> timers;
+        {
+          std::lock_guard<std::mutex> lock(_idle_mtx);
+          _stopping = true;
+          timers.swap(_timers);
+          _next_due = INT64_MAX;
+        }
+        _idle.notify_all();
+        for (size_t n = 0; n < timers.size(); ++n)
+          drop(timers[n].task);
+        for (size_t n = 0; n < _workers.size(); ++n)
+          _workers[n]->thread.join();
+        for (size_t n = 0; n < _workers.size(); ++n)
+          delete _workers[n];
+      }
+
+      unsigned size() const { return unsigned(_workers.size()); }
+
+      static unsigned default_size() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 2;
+      }
+
+      // pool shared by behaviors and native functions, sized by number of CPU cores.
+      // Intentionally never destroyed: joining threads from static destructors
+      // may deadlock (e.g. under loader lock on Windows).
+      static thread_pool& shared() {
+        static thread_pool* _shared = new thread_pool();
+        return *_shared;
+      }
+
+      // true if the caller is a worker thread of this pool
+      bool is_worker_thread() const { return current().pool == this; }
+
+      // fire-and-forget
+      template<typename F>
+        void post(F f, task_priority priority = PRIORITY_NORMAL) {
+          enqueue(new function_task<F>(std::move(f)), priority);
+        }
+
+      // fire-and-forget, runs f after ms milliseconds
+      template<typename F>
+        void post_delayed(unsigned ms, F f, task_priority priority = PRIORITY_NORMAL) {
+          enqueue_delayed(ms, new function_task<F>(std::move(f)), priority);
+        }
+
+      // returns future of f() result
+      template<typename F>
+        auto submit(F f, task_priority priority = PRIORITY_NORMAL) -> task_future<decltype(f())>
+        {
+          typedef decltype(f()) R;
+          std::shared_ptr<future_state<R>> state = std::make_shared<future_state<R>>();
+          enqueue(new packaged_task<R, F>(state, std::move(f)), priority);
+          return task_future<R>(this, state);
+        }
+
+      // runs f after ms milliseconds
+      template<typename F>
+        auto schedule(unsigned ms, F f, task_priority priority = PRIORITY_NORMAL) -> task_future<decltype(f())>
+        {
+          typedef decltype(f()) R;
+          std::shared_ptr<future_state<R>> state = std::make_shared<future_state<R>>();
+          enqueue_delayed(ms, new packaged_task<R, F>(state, std::move(f)), priority);
+          return task_future<R>(this, state);
+        }
+
+      void enqueue(pool_task* t, task_priority priority = PRIORITY_NORMAL)
+      {
+        worker_ctx& ctx = current();
+        if (ctx.pool == this)
+          _workers[ctx.index]->deques[priority].push(t);
+        else {
+          injection_queue& q = _injected[priority];
+          scoped_lock<fast_mutex> lock(q.mtx);
+          q.tasks.push_back(t);
+          ++q.size;
+        }
+        ++_pending;
+        wake_one();
+      }
+
+      void enqueue_delayed(unsigned ms, pool_task* t, task_priority priority = PRIORITY_NORMAL)
+      {
+        timer tm;
+        tm.due = clock::now() + std::chrono::milliseconds(ms);
+        tm.task = t;
+        tm.priority = priority;
+        {
+          std::lock_guard<std::mutex> lock(_idle_mtx);
+          if (_stopping) {
+            tm.task = nullptr;
+          } else {
+            tm.seq = _timer_seq++;
+            _timers.push_back(tm);
+            std::push_heap(_timers.begin(), _timers.end());
+            _next_due = _timers.front().due.time_since_epoch().count();
+          }
+        }
+        if (!tm.task)
+          drop(t);
+        else
+          _idle.notify_all(); // sleepers shall recalculate their timeouts
+      }
+
+      // executes one queued task on the calling worker thread,
+      // used to keep the worker busy while it waits for a future.
+      bool run_one()
+      {
+        worker_ctx& ctx = current();
+        if (ctx.pool != this)
+          return false;
+        pool_task* t = next_task(ctx.index);
+        if (!t)
+          return false;
+        execute(t);
+        return true;
+      }
+
+    private:
+
+      void wake_one()
+      {
+        if (_sleepers.load() == 0)
+          return;
+        { std::lock_guard<std::mutex> lock(_idle_mtx); }
+        _idle.notify_one();
+      }
+
+      static void drop(pool_task* t) {
+        t->cancel();
+        delete t;
+      }
+
+      static void execute(pool_task* t) {
+        try { t->run(); }
+        catch (...) { assert(false); } // fire-and-forget tasks shall not throw
+        delete t;
+      }
+
+      pool_task* take_injected(unsigned priority)
+      {
+        injection_queue& q = _injected[priority];
+        if (q.size.load(std::memory_order_relaxed) == 0)
+          return nullptr;
+        scoped_lock<fast_mutex> lock(q.mtx);
+        if (q.tasks.empty())
+          return nullptr;
+        pool_task* t = q.tasks.front();
+        q.tasks.pop_front();
+        --q.size;
+        return t;
+      }
+
+      pool_task* next_task(unsigned index)
+      {
+        unsigned nworkers = unsigned(_workers.size());
+        for (unsigned p = 0; p < PRIORITY_COUNT; ++p) {
+          pool_task* t = _workers[index]->deques[p].pop();
+          if (!t) t = take_injected(p);
+          for (unsigned n = 1; !t && n < nworkers; ++n)
+            t = _workers[(index + n) % nworkers]->deques[p].steal();
+          if (t) {
+            --_pending;
+            return t;
+          }
+        }
+        return nullptr;
+      }
+
+      // moves due timers to the injection queues, to be called with _idle_mtx locked
+      void promote_timers()
+      {
+        clock::time_point now = clock::now();
+        while (!_timers.empty() && _timers.front().due <= now) {
+          std::pop_heap(_timers.begin(), _timers.end());
+          timer tm = _timers.back();
+          _timers.pop_back();
+          injection_queue& q = _injected[tm.priority];
+          {
+            scoped_lock<fast_mutex> lock(q.mtx);
+            q.tasks.push_back(tm.task);
+            ++q.size;
+          }
+          ++_pending;
+        }
+        _next_due = _timers.empty() ? INT64_MAX : int64_t(_timers.front().due.time_since_epoch().count());
+      }
+
+      void worker_proc(unsigned index)
+      {
+        current().pool = this;
+        current().index = index;
+        for (;;)
+        {
+          if (_next_due.load(std::memory_order_relaxed) <= clock::now().time_since_epoch().count()) {
+            std::lock_guard<std::mutex> lock(_idle_mtx);
+            promote_timers();
+          }
+          if (pool_task* t = next_task(index)) {
+            execute(t);
+            continue;
+          }
+          std::unique_lock<std::mutex> lock(_idle_mtx);
+          promote_timers();
+          if (_pending.load() > 0)
+            continue;
+          if (_stopping)
+            break;
+          ++_sleepers;
+          if (_pending.load() == 0) {
+            uint64_t seq = _timer_seq;
+            auto wakeup = [&]() -> bool { return _pending.load() > 0 || _stopping || _timer_seq != seq; };
+            if (_timers.empty())
+              _idle.wait(lock, wakeup);
+            else
+              _idle.wait_until(lock, _timers.front().due, wakeup);
+          }
+          --_sleepers;
+        }
+        current().pool = nullptr;
+      }
+    };
+
+    // result of thread_pool::submit()/schedule(), copyable.
+    template<typename R>
+    class task_future
+    {
+      friend class thread_pool;
+      friend class gui_queue;
+      template<typename> friend class task_future;
+
+      thread_pool*                      _pool;
+      std::shared_ptr<future_state<R>>  _state;
+
+      task_future(thread_pool* pool, const std::shared_ptr<future_state<R>>& state) : _pool(pool), _state(state) {}
+    public:
+      task_future() : _pool(nullptr) {}
+
+      bool valid() const { return !!_state; }
+      bool ready() const { return _state->ready(); }
+
+      // waits for completion; if called from a worker of the pool
+      // it executes other queued tasks meanwhile so the pool cannot starve itself.
+      void wait() const {
+        if (_pool && _pool->is_worker_thread()) {
+          while (!_state->ready())
+            if (!_pool->run_one())
+              _state->wait_for(1);
+        } else
+          _state->wait();
+      }
+      bool wait_for(unsigned ms) const { return _state->wait_for(ms); }
+
+      // waits and returns the result, rethrows exception thrown by the task
+      auto get() const -> decltype(std::declval<const future_state<R>&>().value()) {
+        wait();
+        if (_state->error())
+          std::rethrow_exception(_state->error());
+        return _state->value();
+      }
+
+      // f(result) (or f() for task_future<void>) is submitted to the pool once this one is ready.
+      // Exceptions propagate through the chain of continuations.
+      template<typename F>
+        auto then(F f, task_priority priority = PRIORITY_NORMAL) const
+          -> task_future<decltype(continuation_call<R>::call(f, std::declval<const future_state<R>&>()))>
+        {
+          typedef decltype(continuation_call<R>::call(f, std::declval<const future_state<R>&>())) RR;
+          std::shared_ptr<future_state<RR>> next = std::make_shared<future_state<RR>>();
+          std::shared_ptr<future_state<R>>  prev = _state;
+          thread_pool* pool = _pool ? _pool : &thread_pool::shared();
+          _state->on_ready([pool, prev, next, f, priority]() {
+            auto step = [prev, next, f]() {
+              if (prev->error())
+                next->set_error(prev->error());
+              else {
+                F fn = f;
+                auto call = [&]() { return continuation_call<R>::call(fn, *prev); };
+                fulfil(*next, call);
+              }
+            };
+            pool->enqueue(new function_task<decltype(step)>(std::move(step)), priority);
+          });
+          return task_future<RR>(pool, next);
+        }
+    };
+
+    // Queue of tasks to be executed in GUI thread.
+    // Producers (any thread) push tasks lock-free, GUI thread drains them in batches:
+    // only the first task of a batch wakes up GUI thread, the rest just join the batch.
+    // Wakeup is platform specific:
+    //   Windows - thread message handled by gui_thread_ctx hook,
+    //   GTK     - g_idle_add(),
+    //   OSX     - main dispatch queue,
+    //   windowless (lite) - host shall call gui_queue::drain() from its loop,
+    //                       optionally installing wakeup proc by set_wakeup().
+    class gui_queue
+    {
+    public:
+      typedef void wakeup_proc();
+
+      // GUI thread is the one that calls bind_gui_thread() (e.g. gui_thread_ctx ctor) or drain() first
+      static void bind_gui_thread() { gui_thread() = std::this_thread::get_id(); }
+      static bool is_gui_thread()   { return gui_thread().load() == std::this_thread::get_id(); }
+
+      // installs function that shall make GUI thread call drain() soon
+      static void set_wakeup(wakeup_proc* pf) { wakeup().store(pf); }
+
+      // fire-and-forget
+      template<typename F>
+        static void post(F f) {
+          enqueue(new function_task<F>(std::move(f)));
+        }
+
+      // returns future of f() result; if called in GUI thread f is executed immediately.
+      // Don't wait for the future in GUI thread - only drain() will complete it.
+      template<typename F>
+        static auto submit(F f) -> task_future<decltype(f())>
+        {
+          typedef decltype(f()) R;
+          std::shared_ptr<future_state<R>> state = std::make_shared<future_state<R>>();
+          packaged_task<R, F>* t = new packaged_task<R, F>(state, std::move(f));
+          if (is_gui_thread()) {
+            t->run();
+            delete t;
+          }
+          else
+            enqueue(t);
+          return task_future<R>(nullptr, state);
+        }
+
+      static void enqueue(pool_task* t)
+      {
+        std::atomic<pool_task*>& top = head();
+        pool_task* old = top.load(std::memory_order_relaxed);
+        do { t->next = old; }
+        while (!top.compare_exchange_weak(old, t, std::memory_order_release, std::memory_order_relaxed));
+        if (!old) // first one in the batch
+          if (wakeup_proc* pf = wakeup().load())
+            pf();
+      }
+
+      // executes queued tasks in order of submission, to be called in GUI thread.
+      // Returns number of executed tasks.
+      static unsigned drain()
+      {
+        if (gui_thread().load() == std::thread::id())
+          bind_gui_thread();
+        assert(is_gui_thread());
+        pool_task* list = head().exchange(nullptr, std::memory_order_acquire);
+        // LIFO -> FIFO
+        pool_task* ordered = nullptr;
+        while (list) {
+          pool_task* next = list->next;
+          list->next = ordered;
+          ordered = list;
+          list = next;
+        }
+        unsigned n = 0;
+        while (ordered) {
+          pool_task* t = ordered;
+          ordered = t->next;
+          try { t->run(); }
+          catch (...) { assert(false); } // fire-and-forget tasks shall not throw
+          delete t;
+          ++n;
+        }
+        return n;
+      }
+
+    private:
+      static std::atomic<pool_task*>& head() {
+        static std::atomic<pool_task*> _head(nullptr);
+        return _head;
+      }
+      static std::atomic<std::thread::id>& gui_thread() {
+        static std::atomic<std::thread::id> _id;
+        return _id;
+      }
+      static std::atomic<wakeup_proc*>& wakeup() {
+        static std::atomic<wakeup_proc*> _wakeup(default_wakeup());
+        return _wakeup;
+      }
+
+#if defined(LINUX) && !defined(WINDOWLESS)
+      static gboolean idle_proc(gpointer) { drain(); return FALSE; }
+      static void wakeup_gtk() { g_idle_add_full(G_PRIORITY_DEFAULT, &idle_proc, nullptr, nullptr); }
+      static wakeup_proc* default_wakeup() { return &wakeup_gtk; }
+#elif defined(OSX) && !defined(WINDOWLESS)
+      static void main_queue_proc(void*) { drain(); }
+      static void wakeup_main_queue() { dispatch_async_f(dispatch_get_main_queue(), nullptr, &main_queue_proc); }
+      static wakeup_proc* default_wakeup() { return &wakeup_main_queue; }
+#else
+      static wakeup_proc* default_wakeup() { return nullptr; } // Windows: set by gui_thread_ctx
+#endif
+    };
+
+#if defined(WINDOWS)
+
+    // Instantiate it in GUI thread before its message loop.
+    // Drains gui_queue from WH_GETMESSAGE hook - that
+    // allows this mechanism to work even under modal dialogs.
+    class gui_thread_ctx
+    {
+      HHOOK _hook;
+
+      typedef std::function<void(void)> gui_block;
+
+      static DWORD& thread_id()
+      {
+        static DWORD _thread_id = ::GetCurrentThreadId();
+        return _thread_id;
+      }
+      static UINT message()
+      {
+        static UINT _message = ::RegisterWindowMessage( TEXT("GUI-THREAD-EXEC_RQ"));
+        return _message;
+      }
+      static void wakeup()
+      {
+        PostThreadMessage(thread_id(), message(), 0, 0);
+      }
+
+      void install_hook()
+      {
+        message(); // force message to be registered
+        thread_id() = ::GetCurrentThreadId();
+        gui_queue::bind_gui_thread();
+        gui_queue::set_wakeup(&wakeup);
+        _hook = ::SetWindowsHookEx(WH_GETMESSAGE,&exec_hook,THIS_HINSTANCE, thread_id());
+        gui_queue::drain(); // tasks queued before the hook was installed
+      }
+      void release_hook()
+      {
+        gui_queue::set_wakeup(nullptr);
+        if(_hook)  ::UnhookWindowsHookEx(_hook);
+      }
+
+      // message hook to drain the queue in GUI thread
+      static LRESULT CALLBACK exec_hook(int code, WPARAM wParam, LPARAM lParam )
+      {
+        MSG* pmsg = reinterpret_cast<MSG*>(lParam);
+        if(wParam == PM_REMOVE && pmsg->message == message())
+          gui_queue::drain();
+        return CallNextHookEx(0,code, wParam,lParam);
+      }
+
+    public:
+      gui_thread_ctx() { install_hook(); }
+      ~gui_thread_ctx() { release_hook(); }
+
+      // this function is called from worker threads to
+      // execute the gui_block in GUI thread, blocks until it is done.
+      // Prefer gui_queue::post() / gui_queue::submit() - they do not stall the worker.
+      static void exec( gui_block code )
+      {
+        gui_queue::submit(std::move(code)).wait();
+      }
+    };
+
+#else
+
+    // Instantiate it in GUI thread before its message loop.
+    class gui_thread_ctx
+    {
+      typedef std::function<void(void)> gui_block;
+    public:
+      gui_thread_ctx() { gui_queue::bind_gui_thread(); }
+
+      // this function is called from worker threads to
+      // execute the gui_block in GUI thread, blocks until it is done.
+      // Prefer gui_queue::post() / gui_queue::submit() - they do not stall the worker.
+      static void exec( gui_block code )
+      {
+        gui_queue::submit(std::move(code)).wait();
+      }
+    };
+
+#endif
+
+    #define GUI_CODE_START azurite::sync::gui_thread_ctx::exec([&]() {
+    #define GUI_CODE_END });
+
+  }
+
+  // runs f on the shared thread pool
+  template<typename F>
+    inline auto async(F f, sync::task_priority priority = sync::PRIORITY_NORMAL) -> sync::task_future<decltype(f())>
+    {
+      return sync::thread_pool::shared().submit(std::move(f), priority);
+    }
+
+}
+
 #endif // __AZURITE_THREADS_H__
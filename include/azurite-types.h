@@ -28,6 +28,9 @@
   #elif _MSC_VER >= 1600
     #define CPP11
   #endif
+  #if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    #define CPP17
+  #endif
   #include <string>
 #else
 
@@ -40,8 +40,9 @@ SAMPLE:
     virtual void attached(HELEMENT he)
     {
       self = he;
+      static const dom::selector selected_tab(":root>.strip>[panel][selected]");
       dom::element tabs_el = he;              //:root below matches the element we use to start lookup from.
-      dom::element tab_el = tabs_el.find_first(":root>.strip>[panel][selected]"); // initialy selected
+      dom::element tab_el = tabs_el.find_first(selected_tab); // initialy selected
 
       azurite::string pname = tab_el.get_attribute("panel");
       // find panel we need to show by default 
@@ -83,7 +84,8 @@ SAMPLE:
 
     static inline bool is_in_focus(const dom::element& el)
     {
-      return el.test(":focus") || el.find_nearest_parent(":focus");
+      static const dom::selector focus(":focus");
+      return el.test(focus) || el.find_nearest_parent(focus);
     }
 
 #ifdef WINDOWS
@@ -92,8 +94,9 @@ SAMPLE:
       if (event_type != KEY_DOWN)
         return FALSE; // we are handling only KEY_DOWN here
 
+      static const dom::selector current_tab(":root>.strip>[panel]:current");
       dom::element tabs_el = he; // our tabs container
-      dom::element tab_el = tabs_el.find_first(":root>.strip>[panel]:current"); // currently selected
+      dom::element tab_el = tabs_el.find_first(current_tab); // currently selected
 
       switch (code)
       {
@@ -134,9 +137,11 @@ SAMPLE:
         // already selected, nothing to do...
         return true; // but we've handled it.
 
+      static const dom::selector expanded_panel(":root>:not(.strip):expanded");
+      static const dom::selector current_tab(":root>.strip>[panel]:current");
       //find currently selected element (tab and panel) and remove "selected" from them
-      dom::element prev_panel_el = tabs_el.find_first(":root>:not(.strip):expanded");
-      dom::element prev_tab_el = tabs_el.find_first(":root>.strip>[panel]:current");
+      dom::element prev_panel_el = tabs_el.find_first(expanded_panel);
+      dom::element prev_tab_el = tabs_el.find_first(current_tab);
 
       // find new tab and panel       
       json::string pname = tab_el.get_attribute("panel");
@@ -222,8 +227,9 @@ SAMPLE:
     // script api
 
     bool select(azurite::value indexOrName) {
+      static const dom::selector strip_tabs(":root>.strip>[panel]");
       dom::element tabs_el = self;
-      auto all_tabs = tabs_el.find_all(":root>.strip>[panel]");
+      auto all_tabs = tabs_el.find_all(strip_tabs);
       if (indexOrName.is_int()) {
         int idx = indexOrName.get<int>();
         if (idx >= 0 && idx < int(all_tabs.size()))
@@ -242,8 +248,9 @@ SAMPLE:
     }
 
     std::vector<azurite::string> names() {
+      static const dom::selector strip_tabs(":root>.strip>[panel]");
       dom::element tabs_el = self;
-      auto all_tabs = tabs_el.find_all(":root>.strip>[panel]");
+      auto all_tabs = tabs_el.find_all(strip_tabs);
       std::vector<azurite::string> all_names;
       for (auto tab : all_tabs) {
         all_names.push_back(tab.get_attribute("panel"));
@@ -252,8 +259,9 @@ SAMPLE:
     }
 
     azurite::string get_current() {
+      static const dom::selector current_tab(":root>.strip>[panel]:current");
       dom::element tabs_el = self;
-      dom::element current_tab_el = tabs_el.find_first(":root>.strip>[panel]:current");
+      dom::element current_tab_el = tabs_el.find_first(current_tab);
       if (current_tab_el)
         return current_tab_el.get_attribute("panel");
       return azurite::string();
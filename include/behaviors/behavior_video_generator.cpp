@@ -4,6 +4,7 @@
 #include "azurite-behavior.h"
 #include "azurite-threads.h"
 #include "azurite-video-api.h"
+#include <random>
 
 namespace azurite
 {
@@ -53,49 +54,60 @@ namespace azurite
 
       if (rendering_site->asset_get_interface(FRAGMENTED_VIDEO_DESTINATION_INAME, fsite.target()))
       {
-        azurite::thread(generation_thread, fsite);
+        std::shared_ptr<generator> gen = std::make_shared<generator>(fsite);
+        azurite::sync::thread_pool::shared().post_delayed(100, [gen]() { gen->start(); });
       }
 
       return true;
     }
 
-    static void generation_thread(azurite::fragmented_video_destination* dst) {
-      azurite::om::hasset<azurite::fragmented_video_destination> rendering_site = dst;
-      // simulate video stream
-      azurite::sync::sleep(100);
-
-      const int VIDEO_WIDTH = 1200;
-      const int VIDEO_HEIGHT = 800;
-      const int FRAGMENT_WIDTH = 256;
-      const int FRAGMENT_HEIGHT = 32;
+    // produces frames on the shared thread pool - one short task per frame
+    // rather than a dedicated thread per <video> element
+    struct generator : public std::enable_shared_from_this<generator>
+    {
+      static const int VIDEO_WIDTH = 1200;
+      static const int VIDEO_HEIGHT = 800;
+      static const int FRAGMENT_WIDTH = 256;
+      static const int FRAGMENT_HEIGHT = 32;
 
-      srand((unsigned int)(UINT_PTR)dst);
+      azurite::om::hasset<azurite::fragmented_video_destination> rendering_site;
+      unsigned int figure[FRAGMENT_WIDTH*FRAGMENT_HEIGHT];
+      std::minstd_rand rng; // steps run on different pool threads, rand() state is not theirs to share
 
-      // let's pretend that we have 640*480 video frames
-      rendering_site->start_streaming(VIDEO_WIDTH, VIDEO_HEIGHT, COLOR_SPACE_RGB32);
+      int xpos = 0;
+      int ypos = 0;
+      int stepx = +1;
+      int stepy = +1;
 
-      unsigned int figure[FRAGMENT_WIDTH*FRAGMENT_HEIGHT];// = {0xFFFF00FF};
+      generator(azurite::fragmented_video_destination* dst) : rendering_site(dst) {}
 
-      auto generate_fill_color = [&]() {
+      void generate_fill_color() {
         unsigned color =
           0xff000000 |
-          ((unsigned(rand()) & 0xff) << 16) |
-          ((unsigned(rand()) & 0xff) << 8) |
-          ((unsigned(rand()) & 0xff) << 0);
+          ((unsigned(rng()) & 0xff) << 16) |
+          ((unsigned(rng()) & 0xff) << 8) |
+          ((unsigned(rng()) & 0xff) << 0);
         for (int i = 0; i < FRAGMENT_WIDTH * FRAGMENT_HEIGHT; ++i)
           figure[i] = color;
-      };
+      }
 
-      generate_fill_color();
+      void start() {
+        rng.seed((unsigned int)(UINT_PTR)(azurite::fragmented_video_destination*)rendering_site);
+        // let's pretend that we have 1200*800 video frames
+        rendering_site->start_streaming(VIDEO_WIDTH, VIDEO_HEIGHT, COLOR_SPACE_RGB32);
+        generate_fill_color();
+        next();
+      }
 
-      int xpos = 0;
-      int ypos = 0;
-      int stepx = +1;
-      int stepy = +1;
+      void next() {
+        std::shared_ptr<generator> self = shared_from_this();
+        azurite::sync::thread_pool::shared().post_delayed(40, [self]() { self->step(); }); // simulate 24 FPS rate
+      }
 
-      while (rendering_site->is_alive())
+      void step()
       {
-        azurite::sync::sleep(40); // simulate 24 FPS rate
+        if (!rendering_site->is_alive())
+          return;
 
         xpos += stepx;
         if (xpos < 0) { xpos = 0; stepx = -stepx; generate_fill_color(); }
@@ -106,9 +118,9 @@ namespace azurite
         if (ypos >= VIDEO_HEIGHT - FRAGMENT_HEIGHT) { ypos = VIDEO_HEIGHT - FRAGMENT_HEIGHT; stepy = -stepy; generate_fill_color(); }
 
         rendering_site->render_frame_part((const unsigned char*)figure, sizeof(figure), xpos, ypos, FRAGMENT_WIDTH, FRAGMENT_HEIGHT);
+        next();
       }
-
-    }
+    };
 
   };
 
@@ -4,7 +4,8 @@
 #include "azurite-behavior.h"
 #include "azurite-threads.h"
 #include "azurite-video-api.h"
-#include <thread>
+#include <random>
+#include <vector>
 
 namespace azurite
 {
@@ -54,54 +55,66 @@ namespace azurite
 
       if (rendering_site->asset_get_interface(VIDEO_DESTINATION_INAME, fsite.target()))
       {
-        std::thread(generation_thread, fsite).detach();
+        std::shared_ptr<generator> gen = std::make_shared<generator>(fsite);
+        azurite::sync::thread_pool::shared().post_delayed(100, [gen]() { gen->start(); });
       }
 
       return true;
     }
 
-    static void generation_thread(azurite::om::hasset<azurite::video_destination> rendering_site) {
-      // simulate video stream
-      azurite::sync::sleep(100);
-
-      const int VIDEO_WIDTH = 800;
-      const int VIDEO_HEIGHT = 600;
-
-      // let's pretend that we have 800*600 video frames
-      rendering_site->start_streaming(VIDEO_WIDTH, VIDEO_HEIGHT, COLOR_SPACE_RGB32);
+    // produces frames on the shared thread pool - one short task per frame
+    // rather than a dedicated thread per <video> element
+    struct generator : public std::enable_shared_from_this<generator>
+    {
+      static const int VIDEO_WIDTH = 800;
+      static const int VIDEO_HEIGHT = 600;
 
-      unsigned int *frame = new unsigned int[VIDEO_WIDTH*VIDEO_HEIGHT];
+      azurite::om::hasset<azurite::video_destination> rendering_site;
+      std::vector<unsigned int> frame;
+      unsigned color = 0;
+      int start_pos = 0;
+      std::minstd_rand rng; // steps run on different pool threads, rand() state is not theirs to share
 
-      unsigned color = rand();
-      srand((unsigned int)(UINT_PTR)(azurite::video_destination*)rendering_site);
-      int start = 0;
+      generator(azurite::video_destination* dst) : rendering_site(dst), frame(VIDEO_WIDTH*VIDEO_HEIGHT) {}
 
-      auto generate_fill_color = [&]() {
+      void generate_fill_color() {
         color = 0xff000000 |
-          ((unsigned(rand()) & 0xff) << 16) |
-          ((unsigned(rand()) & 0xff) << 8) |
-          ((unsigned(rand()) & 0xff) << 0);
-      };
+          ((unsigned(rng()) & 0xff) << 16) |
+          ((unsigned(rng()) & 0xff) << 8) |
+          ((unsigned(rng()) & 0xff) << 0);
+      }
 
-      generate_fill_color();
+      void start() {
+        // let's pretend that we have 800*600 video frames
+        rendering_site->start_streaming(VIDEO_WIDTH, VIDEO_HEIGHT, COLOR_SPACE_RGB32);
+        rng.seed((unsigned int)(UINT_PTR)(azurite::video_destination*)rendering_site);
+        generate_fill_color();
+        next();
+      }
 
-      while (rendering_site->is_alive())
+      void next() {
+        std::shared_ptr<generator> self = shared_from_this();
+        azurite::sync::thread_pool::shared().post_delayed(30, [self]() { self->step(); }); // simulate 33 FPS rate
+      }
+
+      void step()
       {
-        std::this_thread::sleep_for(std::chrono::milliseconds(30)); // simulate 33 FPS rate
+        if (!rendering_site->is_alive())
+          return;
 
-        ++start;
-        if (start > 80) {
-          start = 0;
+        ++start_pos;
+        if (start_pos > 80) {
+          start_pos = 0;
           generate_fill_color();
         }
-        
-        for (int n = start; n < VIDEO_WIDTH*VIDEO_HEIGHT; n += 80) {
+
+        for (int n = start_pos; n < VIDEO_WIDTH*VIDEO_HEIGHT; n += 80) {
           frame[n] = color;
         }
-        rendering_site->render_frame((const unsigned char*)frame, sizeof(unsigned int) * VIDEO_WIDTH * VIDEO_HEIGHT);
+        rendering_site->render_frame((const unsigned char*)frame.data(), sizeof(unsigned int) * VIDEO_WIDTH * VIDEO_HEIGHT);
+        next();
       }
-      delete[] frame;
-    }
+    };
 
   };
 
@@ -225,11 +225,34 @@ namespace camera {
       IMFSample *pSample      // Can be NULL
       )
   {
-      azurite::sync::critical_section _(m_lock);
-
-      if (!is_capturing() || !dest)
+      // state needed by this sample is taken under the lock, the engine is called without it:
+      // render_frame() may take long and must not block end_capture()/is_capturing() callers
+      azurite::om::hasset<azurite::video_destination> destination;
+      com::ptr<IMFSourceReader> reader;
+      bool     first_sample = false;
+      unsigned width = 0, height = 0;
+      azurite::COLOR_SPACE color_space = azurite::COLOR_SPACE_UNKNOWN;
       {
-          return S_OK;
+          azurite::sync::critical_section _(m_lock);
+
+          if (!capturing() || !m_pReader)
+          {
+              return S_OK;
+          }
+
+          destination = dest;
+          reader = m_pReader;
+          if (pSample && m_bFirstSample)
+          {
+              m_llBaseTime = llTimeStamp;
+              m_bFirstSample = FALSE;
+              first_sample = true;
+          }
+          width = m_width;
+          height = m_height;
+          color_space = m_colorSpace;
+          // rebase the time stamp
+          llTimeStamp -= m_llBaseTime;
       }
 
       HRESULT hr = S_OK;
@@ -242,15 +265,8 @@ namespace camera {
 
       if (pSample)
       {
-          if (m_bFirstSample)
-          {
-              m_llBaseTime = llTimeStamp;
-              m_bFirstSample = FALSE;
-              dest->start_streaming(m_width,m_height,m_colorSpace);
-          }
-
-          // rebase the time stamp
-          llTimeStamp -= m_llBaseTime;
+          if (first_sample)
+              destination->start_streaming(width,height,color_space);
 
           hr = pSample->SetSampleTime(llTimeStamp);
 
@@ -269,7 +285,7 @@ namespace camera {
           if (FAILED(hr))
             goto done; 
 
-          if(!dest->render_frame(data,length)) { 
+          if(!destination->render_frame(data,length)) { 
             pBuffer->Unlock();
             goto done; 
           }
@@ -279,7 +295,7 @@ namespace camera {
       }
 
       // Read another sample.
-      hr = m_pReader->ReadSample(
+      hr = reader->ReadSample(
           (DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM,
           0,
           NULL,   // actual
@@ -291,8 +307,7 @@ namespace camera {
   done:
       if (FAILED(hr))
       {
-        if(dest) 
-          dest->stop_streaming();
+        destination->stop_streaming();
       }
       return hr;
   }
@@ -424,7 +439,7 @@ namespace camera {
   { 
       azurite::sync::critical_section _(m_lock);
 
-      return dest && dest->is_alive();
+      return capturing();
   
   }
 
@@ -444,7 +459,7 @@ namespace camera {
 
       deviceLost = false;
     
-      if (!is_capturing())
+      if (!capturing())
       {
           return true;
       }
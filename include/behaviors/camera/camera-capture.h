@@ -121,12 +121,15 @@ namespace camera {
 
 		void    NotifyError(HRESULT hr) { /*PostMessage(m_hwndEvent, WM_APP_PREVIEW_ERROR, (WPARAM)hr, 0L);*/ }
 
+		// is_capturing() for callers holding m_lock already, m_lock is not recursive
+		bool    capturing() const { return dest && dest->is_alive(); }
+
 		HRESULT OpenMediaSource(IMFMediaSource *pSource);
 		HRESULT ConfigureCapture(const encoding_parameters& param);
 
 		long                      m_nRefCount;        // Reference count.
 
-    azurite::sync::mutex       m_lock;
+    azurite::sync::fast_mutex  m_lock;
 
 		com::ptr<IMFSourceReader> m_pReader;
 
@@ -0,0 +1,334 @@
+// Copyright(c) 2024  Case Technologies 
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef __value_algorithms_hpp__
+#define __value_algorithms_hpp__
+
+/*
+ * Parallel algorithms over arrays and maps:
+ *
+ *   using namespace azurite::algorithms;
+ *   value sorted  = sort(rows, by("price", 0.0), std::less<double>());
+ *   value cheap   = filter(rows, by("price", 0.0), [](double price) { return price < 10; });
+ *   value byCity  = group_by(rows, by("city", azurite::string()));
+ *   double total  = reduce(rows, by("price", 0.0), 0.0, [](double price) { return price; }, std::plus<double>());
+ *   value prices  = value(transform(rows, by("price", 0.0), [](double price) { return price * 1.2; }));
+ *
+ * The engine is touched only on the calling thread: there the source is isolated (ValueIsolate),
+ * its elements are taken and projected to plain data - proj(const value& element) is a field
+ * extractor like by() above or any function returning a C++ type that does not refer to engine values.
+ * Callbacks run on the pool threads and get projected data only.
+ * Resulting values are built on the calling thread, in bulk.
+ * For maps elements are values of key/value pairs, results keep the keys.
+ */
+
+#include "value.hpp"
+#include "azurite-threads.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <exception>
+
+#if defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+namespace azurite
+{
+
+  namespace algorithms
+  {
+
+    using azurite::sync::thread_pool;
+    using azurite::sync::task_future;
+
+    // projection to element[name].get<T>() or def if there is no such field,
+    // T shall own its data (e.g. azurite::string, not aux::wchars)
+    template<typename T>
+      struct field
+      {
+        const char* name;
+        T           def;
+        T operator()(const value& element) const
+        {
+          if (!element.is_map()) return def;
+          value v = element[name];
+          return v.is_undefined() ? def : v.get<T>();
+        }
+      };
+    template<typename T>
+      inline field<T> by(const char* name, T def) { field<T> f = { name, def }; return f; }
+
+    // std::vector<bool> is bit-packed, its elements cannot be stored by different threads,
+    // so results of type T are stored as slot<T>::type and unpacked on the calling thread
+    template<typename T>
+      struct slot
+      {
+        typedef T type;
+        static std::vector<T> unpack(std::vector<T>& v) { return std::move(v); }
+      };
+    template<>
+      struct slot<bool>
+      {
+        typedef char type;
+        static std::vector<bool> unpack(std::vector<char>& v) { return std::vector<bool>(v.begin(), v.end()); }
+      };
+
+    // f(begin, end) over [0, n) split into chunks of at least grain elements,
+    // the last chunk runs on the calling thread. Rethrows exception of any chunk.
+    template<typename F>
+      inline void parallel_for(size_t n, F f, thread_pool& pool = thread_pool::shared(), size_t grain = 1024)
+      {
+        size_t chunks = (n + grain - 1) / grain;
+        size_t limit = size_t(pool.size()) * 4;
+        if (chunks > limit) chunks = limit;
+        if (chunks <= 1) { if (n) f(size_t(0), n); return; }
+        std::vector< task_future<void> > pending;
+        pending.reserve(chunks - 1);
+        size_t step = n / chunks;
+        size_t begin = 0;
+        for (size_t c = 0; c + 1 < chunks; ++c, begin += step) {
+          size_t b = begin, e = begin + step;
+          pending.push_back(pool.submit([&f, b, e]() { f(b, e); }));
+        }
+        std::exception_ptr error;
+        try { f(begin, n); } catch (...) { error = std::current_exception(); }
+        for (size_t c = 0; c < pending.size(); ++c) { // all chunks shall finish before rethrow - they use caller's frame
+          try { pending[c].get(); } catch (...) { if (!error) error = std::current_exception(); }
+        }
+        if (error)
+          std::rethrow_exception(error);
+      }
+
+    // consistent copy of array or map elements
+    class snapshot
+    {
+    public:
+      explicit snapshot(const value& src): _src(src), _is_map(false)
+      {
+        ValueIsolate(&_src);
+        if (_src.is_map()) {
+          _is_map = true;
+          _keys.reserve(size_t(_src.length()));
+          _vals.reserve(size_t(_src.length()));
+          collector c(*this);
+          _src.enum_elements(c);
+        }
+        else if (_src.is_array_like()) {
+          int n = _src.length();
+          _vals.resize(size_t(n));
+          for (int i = 0; i < n; ++i)
+            ValueNthElementValue(&_src, i, &_vals[size_t(i)]);
+        }
+      }
+
+      bool         is_map() const { return _is_map; }
+      size_t       size() const { return _vals.size(); }
+      const value& operator[](size_t i) const { return _vals[i]; }
+      const value& key(size_t i) const { return _keys[i]; }
+
+      // proj(element) of each element, on the calling thread
+      template<typename PROJ>
+        auto project(PROJ proj) const -> std::vector<typename std::decay<decltype(proj(std::declval<const value&>()))>::type>
+        {
+          std::vector<typename std::decay<decltype(proj(std::declval<const value&>()))>::type> r;
+          r.reserve(_vals.size());
+          for (size_t i = 0; i < _vals.size(); ++i)
+            r.push_back(proj(_vals[i]));
+          return r;
+        }
+
+      // array or map (same as the source) of elements at indices, in one engine call
+      value make(const std::vector<size_t>& indices) const
+      {
+        value r;
+        if (_is_map) {
+          ValueIntDataSet(&r, 0, T_MAP, 0);
+          std::vector<VALUE> kv(indices.size() * 2);
+          for (size_t i = 0; i < indices.size(); ++i) {
+            kv[i * 2] = _keys[indices[i]];     // borrowed, the engine copies them
+            kv[i * 2 + 1] = _vals[indices[i]];
+          }
+          if (indices.size())
+            ValueMapSetItems(&r, UINT(indices.size()), kv.data());
+        }
+        else {
+          ValueIntDataSet(&r, INT(indices.size()), T_ARRAY, 0);
+          std::vector<VALUE> vs(indices.size());
+          for (size_t i = 0; i < indices.size(); ++i)
+            vs[i] = _vals[indices[i]];
+          if (indices.size())
+            ValueArraySetRange(&r, 0, UINT(indices.size()), vs.data());
+        }
+        return r;
+      }
+
+    private:
+      value              _src;
+      bool               _is_map;
+      std::vector<value> _keys;
+      std::vector<value> _vals;
+
+      struct collector : value::enum_cb
+      {
+        snapshot& s;
+        collector(snapshot& ss): s(ss) {}
+        virtual bool on(const value& key, const value& val)
+        {
+          s._keys.push_back(key);
+          s._vals.push_back(val);
+          return true;
+        }
+      };
+    };
+
+    // copy sorted by less(proj(a), proj(b)); chunks are sorted in parallel and then merged pairwise in parallel
+    template<typename PROJ, typename LESS>
+      inline value sort(const value& src, PROJ proj, LESS less, thread_pool& pool = thread_pool::shared())
+      {
+        snapshot s(src);
+        auto keys = s.project(proj);
+        size_t n = s.size();
+        std::vector<size_t> idx(n), tmp(n);
+        for (size_t i = 0; i < n; ++i) idx[i] = i;
+        auto cmp = [&keys, &less](size_t a, size_t b) { return less(keys[a], keys[b]); };
+
+        size_t runs = std::min(size_t(pool.size()) * 2, (n + 4095) / 4096);
+        if (runs <= 1) {
+          std::sort(idx.begin(), idx.end(), cmp);
+          return s.make(idx);
+        }
+        std::vector<size_t> bounds(runs + 1);
+        for (size_t r = 0; r <= runs; ++r) bounds[r] = n * r / runs;
+        parallel_for(runs, [&](size_t b, size_t e) {
+          for (size_t r = b; r < e; ++r)
+            std::sort(idx.begin() + bounds[r], idx.begin() + bounds[r + 1], cmp);
+        }, pool, 1);
+        while (bounds.size() > 2) {
+          size_t pairs = (bounds.size() - 1) / 2;
+          parallel_for(pairs, [&](size_t b, size_t e) {
+            for (size_t p = b; p < e; ++p) {
+              size_t lo = bounds[p * 2], mid = bounds[p * 2 + 1], hi = bounds[p * 2 + 2];
+              std::merge(idx.begin() + lo, idx.begin() + mid, idx.begin() + mid, idx.begin() + hi, tmp.begin() + lo, cmp);
+            }
+          }, pool, 1);
+          std::vector<size_t> next;
+          for (size_t p = 0; p < pairs; ++p)
+            next.push_back(bounds[p * 2]);
+          if ((bounds.size() - 1) % 2) { // odd run goes as is
+            size_t lo = bounds[bounds.size() - 2];
+            std::copy(idx.begin() + lo, idx.end(), tmp.begin() + lo);
+            next.push_back(lo);
+          }
+          next.push_back(n);
+          bounds.swap(next);
+          idx.swap(tmp);
+        }
+        return s.make(idx);
+      }
+
+    // elements for which pred(proj(element)) is true, order is preserved
+    template<typename PROJ, typename PRED>
+      inline value filter(const value& src, PROJ proj, PRED pred, thread_pool& pool = thread_pool::shared())
+      {
+        snapshot s(src);
+        auto data = s.project(proj);
+        std::vector<char> keep(s.size());
+        parallel_for(s.size(), [&](size_t b, size_t e) {
+          for (size_t i = b; i < e; ++i) keep[i] = pred(data[i]) ? 1 : 0;
+        }, pool);
+        std::vector<size_t> idx;
+        for (size_t i = 0; i < keep.size(); ++i)
+          if (keep[i]) idx.push_back(i);
+        return s.make(idx);
+      }
+
+    // std::vector of f(proj(element)) results, value(transform(...)) makes array of them in bulk
+    template<typename PROJ, typename F>
+      inline auto transform(const value& src, PROJ proj, F f, thread_pool& pool = thread_pool::shared())
+        -> std::vector<typename std::decay<decltype(f(proj(std::declval<const value&>())))>::type>
+      {
+        typedef typename std::decay<decltype(f(proj(std::declval<const value&>())))>::type T;
+        snapshot s(src);
+        auto data = s.project(proj);
+        std::vector<typename slot<T>::type> out(s.size());
+        parallel_for(s.size(), [&](size_t b, size_t e) {
+          for (size_t i = b; i < e; ++i) out[i] = f(data[i]);
+        }, pool);
+        return slot<T>::unpack(out);
+      }
+
+    // combine(... combine(combine(init, f(p0)), f(p1)) ..., f(pn)) where pN is proj(element N),
+    // chunks are reduced in parallel each starting from init so init shall be identity of combine
+    template<typename PROJ, typename T, typename F, typename COMBINE>
+      inline T reduce(const value& src, PROJ proj, T init, F f, COMBINE combine, thread_pool& pool = thread_pool::shared())
+      {
+        snapshot s(src);
+        auto data = s.project(proj);
+        size_t chunks = std::max<size_t>(1, std::min(size_t(pool.size()) * 4, (s.size() + 1023) / 1024));
+        std::vector<typename slot<T>::type> partial(chunks, init);
+        parallel_for(chunks, [&](size_t b, size_t e) {
+          for (size_t c = b; c < e; ++c) {
+            T acc = init;
+            for (size_t i = s.size() * c / chunks, end = s.size() * (c + 1) / chunks; i < end; ++i)
+              acc = combine(acc, f(data[i]));
+            partial[c] = acc;
+          }
+        }, pool, 1);
+        T r = init;
+        for (size_t c = 0; c < chunks; ++c)
+          r = combine(r, partial[c]);
+        return r;
+      }
+
+    // map { key_of(element) : [elements...] }, keys are ordered, elements keep their order.
+    // Keys are projections so they are taken on the calling thread, grouping is sequential
+    template<typename KEY_OF>
+      inline value group_by(const value& src, KEY_OF key_of)
+      {
+        snapshot s(src);
+        auto keys = s.project(key_of);
+        typedef typename decltype(keys)::value_type K;
+        std::map< K, std::vector<size_t> > groups;
+        for (size_t i = 0; i < keys.size(); ++i)
+          groups[keys[i]].push_back(i);
+
+        std::vector< std::pair<value,value> > items;
+        items.reserve(groups.size());
+        for (typename std::map< K, std::vector<size_t> >::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+          value members;
+          ValueIntDataSet(&members, INT(it->second.size()), T_ARRAY, 0);
+          std::vector<VALUE> vs(it->second.size());
+          for (size_t i = 0; i < vs.size(); ++i)
+            vs[i] = s[it->second[i]];
+          ValueArraySetRange(&members, 0, UINT(vs.size()), vs.data());
+          items.push_back(std::pair<value,value>(value(it->first), std::move(members)));
+        }
+        value r = value::make_map();
+        if (items.size())
+          r.set_items(items.data(), unsigned(items.size()));
+        return r;
+      }
+
+  }
+
+}
+
+#endif //defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+#endif
@@ -119,6 +119,20 @@ enum VALUE_UNIT_TYPE_STRING
     UT_STRING_SYMBOL = 0xffff,   // symbol in tiscript sense
 };
 
+// T_BYTES units - element type of typed array, script sees such values as typed arrays
+enum VALUE_UNIT_TYPE_BYTES
+{
+    UT_BYTES_RAW     = 0, // plain sequence of bytes
+    UT_BYTES_UINT8   = 1, // Uint8Array
+    UT_BYTES_INT8    = 2, // Int8Array
+    UT_BYTES_UINT16  = 3, // Uint16Array
+    UT_BYTES_INT16   = 4, // Int16Array
+    UT_BYTES_UINT32  = 5, // Uint32Array
+    UT_BYTES_INT32   = 6, // Int32Array
+    UT_BYTES_FLOAT32 = 7, // Float32Array
+    UT_BYTES_FLOAT64 = 8, // Float64Array
+};
+
 // Native functor
 typedef VOID NATIVE_FUNCTOR_INVOKE( VOID* tag, UINT argc, const VALUE* argv, VALUE* retval); // retval may contain error definition
 typedef VOID NATIVE_FUNCTOR_RELEASE( VOID* tag );
@@ -212,6 +226,15 @@ UINT SCAPI ValueBinaryData( const VALUE* pval, LPCBYTE* pBytes, UINT* pnBytes );
  */
 UINT SCAPI ValueBinaryDataSet( VALUE* pval, LPCBYTE pBytes, UINT nBytes, UINT type, UINT units );
 
+/**
+ * ValueBinaryDataSetExternal - sets VALUE to T_BYTES referring to external memory, without copying.
+ * - 'units' is one of VALUE_UNIT_TYPE_BYTES, nBytes shall be multiple of element size;
+ * - the memory shall stay valid (and may be modified by script) until prelease(tag) is called,
+ *   that happens when the last reference to the data is gone; prelease may be NULL for static data.
+ * Requires API_VERSION 11, on older engines the data is copied and prelease(tag) is called immediately.
+ */
+UINT SCAPI ValueBinaryDataSetExternal( VALUE* pval, BYTE* pBytes, UINT nBytes, UINT units, NATIVE_FUNCTOR_RELEASE* prelease, VOID* tag);
+
 /**
  * ValueElementsCount - retreive number of sub-elements for:
  * - T_ARRAY - number of elements in the array; 
@@ -274,6 +297,38 @@ UINT SCAPI ValueSetValueToKey( VALUE* pval, const VALUE* pkey, const VALUE* pval
  */
 UINT SCAPI ValueGetValueOfKey( const VALUE* pval, const VALUE* pkey, VALUE* pretval);
 
+/**
+ * ValueGetValueOfPath - retrieves value of nested sub-element by sequence of n keys, in one call:
+ * - T_INT key on array (T_ARRAY or script Array) - element at that index;
+ * - other keys - as ValueGetValueOfKey.
+ * If some element on the path does not exist *pretval will have T_UNDEFINED value.
+ * Requires API_VERSION 12, on older engines it is emulated by ValueNthElementValue/ValueGetValueOfKey calls.
+ */
+UINT SCAPI ValueGetValueOfPath( const VALUE* pval, UINT n, const VALUE* pkeys, VALUE* pretval);
+
+/**
+ * ValueArraySetRange - sets n elements of the array starting at index first in one call:
+ * - T_ARRAY or array object - elements [first, first + n) are set, the array is expanded if needed;
+ * - otherwise the VALUE becomes T_ARRAY of first + n elements.
+ * Requires API_VERSION 10, emulated by ValueNthElementValueSet calls on older engines.
+ */
+UINT SCAPI ValueArraySetRange( VALUE* pval, INT first, UINT n, const VALUE* pvals);
+
+/**
+ * ValueMapSetItems - sets n key/value pairs in one call,
+ * pkeyvals is a vector of 2*n values: key0, value0, key1, value1, ...
+ * - T_MAP, T_OBJECT - pairs are added/replaced;
+ * - otherwise the VALUE becomes T_MAP containing the pairs.
+ * Requires API_VERSION 10, emulated by ValueSetValueToKey calls on older engines.
+ */
+UINT SCAPI ValueMapSetItems( VALUE* pval, UINT n, const VALUE* pkeyvals);
+
+/**
+ * ValueReserve - capacity hint for T_ARRAY and T_MAP values that are about to grow,
+ * does not change number of elements. No-op on engines older than API_VERSION 10.
+ */
+UINT SCAPI ValueReserve( VALUE* pval, UINT capacity);
+
 enum VALUE_STRING_CVT_TYPE
 {
   CVT_SIMPLE,        ///< simple conversion of terminal values 
@@ -29,11 +29,21 @@
   #include <initializer_list>
   #include <utility>
   #include <type_traits>
+  #include <tuple>
+  #include <array>
+  #include <map>
+  #include <unordered_map>
+#endif
+#ifdef CPP17
+  #include <optional>
 #endif
 
   #include "aux-slice.h"
   #include "aux-cvt.h"
   #include "azurite-types.h"
+#ifdef CPP11
+  #include "aux-intern.h"
+#endif
 
 #if defined(_MSC_VER) && (_MSC_VER < 1600) // MSVC version < 8
      #include "nullptr.hpp"
@@ -64,12 +74,48 @@
 
     typedef std::runtime_error script_error;
 
+    // element type of typed array -> VALUE_UNIT_TYPE_BYTES
+    template<typename T> struct typed_array_units { enum { supported = 0, units = -1 }; };
+    template<> struct typed_array_units<uint8_t>  { enum { supported = 1, units = UT_BYTES_UINT8 }; };
+    template<> struct typed_array_units<int8_t>   { enum { supported = 1, units = UT_BYTES_INT8 }; };
+    template<> struct typed_array_units<uint16_t> { enum { supported = 1, units = UT_BYTES_UINT16 }; };
+    template<> struct typed_array_units<int16_t>  { enum { supported = 1, units = UT_BYTES_INT16 }; };
+    template<> struct typed_array_units<uint32_t> { enum { supported = 1, units = UT_BYTES_UINT32 }; };
+    template<> struct typed_array_units<int32_t>  { enum { supported = 1, units = UT_BYTES_INT32 }; };
+    template<> struct typed_array_units<float>    { enum { supported = 1, units = UT_BYTES_FLOAT32 }; };
+    template<> struct typed_array_units<double>   { enum { supported = 1, units = UT_BYTES_FLOAT64 }; };
+
     // value by key bidirectional proxy/accessor 
     class value_key_a;
     // value by index bidirectional proxy/accessor 
     class value_idx_a;
     class value;
 
+#ifdef CPP11
+    // symbol value of the name, created once per name in the process (or nullptr if interning table is full)
+    inline const value* intern_symbol(const char* name, uint64_t hash);
+    inline const value* intern_symbol(const char* name) { return intern_symbol(name, aux::fnv1a(name)); }
+#endif
+
+    // setter - free standing conversion of T to azurite::value, used by value(const T&).
+    // Declared upfront so value(const T&) sees it for types from other namespaces.
+    template<typename T>
+      value setter(const T& v);
+#ifdef CPP11
+    template<typename K, typename V, typename C, typename A>
+      value setter(const std::map<K,V,C,A>& m);
+    template<typename K, typename V, typename H, typename E, typename A>
+      value setter(const std::unordered_map<K,V,H,E,A>& m);
+    template<typename R, typename... P>
+      value setter(R(*func)(P...));
+    template<typename R, typename... P>
+      value setter(std::function<R(P...)> func);
+#endif
+#ifdef CPP17
+    template<typename T>
+      value setter(const std::optional<T>& v);
+#endif
+
 #ifdef CPP11
     // native function that can be stored inside the value:
     typedef std::function<value(unsigned int argc, const value* argv)> native_function_t;
@@ -80,6 +126,44 @@
       value(void*) {} // no such thing, sorry
       //void* get(const void* defv) const { return 0; } // and this one too is disabled
       //void* get(const void* defv) { return 0; } // and this one too is disabled
+
+      template<typename T>
+        static VOID release_vector(VOID* tag) { delete static_cast<std::vector<T>*>(tag); }
+
+      // makes this an array of n elements converted from the sequence,
+      // elements are passed to the engine in chunks - one call per chunk
+      template<typename IT>
+        void assign_array(IT it, size_t n);
+
+#ifdef CPP11
+      // get_path() keys: value lvalues and interned names are borrowed (bitwise copies),
+      // anything else gets converted to a key owned by the path, returns true if the key has to be cleared
+      static bool path_key(VALUE& k, const value& v) { k = v; return false; }
+      static bool path_key(VALUE& k, int i) { ValueInit(&k); ValueIntDataSet(&k, i, T_INT, 0); return true; }
+      static bool path_key(VALUE& k, const char* name);
+      template<typename T>
+        static bool path_key(VALUE& k, const T& v, std::true_type /*integral*/) { return path_key(k, int(v)); }
+      template<typename T>
+        static bool path_key(VALUE& k, const T& v, std::false_type)
+        {
+          value t(v);
+          ValueInit(&k);
+          std::swap(k, *(VALUE*)&t); // t is left empty
+          return true;
+        }
+      template<typename T>
+        static bool path_key(VALUE& k, const T& v)
+        {
+          return path_key(k, v, std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>());
+        }
+      static void fill_path(VALUE*, bool*) {}
+      template<typename K, typename... R>
+        static void fill_path(VALUE* path, bool* owned, const K& key, const R&... rest)
+        {
+          *owned = path_key(*path, key);
+          fill_path(path + 1, owned + 1, rest...);
+        }
+#endif
     public:
       value()                 { ValueInit(this); }
      ~value()                 { ValueClear(this); }
@@ -87,7 +171,9 @@
       value(const VALUE& src) { ValueInit(this); ValueCopy(this,&src); }
 
 #ifdef CPP11
-      value(value&& src) { ValueInit(this); std::swap( *(VALUE*)this, *(VALUE*)&src); }
+      value(value&& src) noexcept { ValueInit(this); std::swap( *(VALUE*)this, *(VALUE*)&src); }
+      // src gets old content of this and releases it
+      value& operator = (value&& src) noexcept { std::swap( *(VALUE*)this, *(VALUE*)&src); return *this; }
 #endif
 
       value(const value_key_a& src);
@@ -110,12 +196,12 @@
       value( aux::bytes bs )    { ValueInit(this); ValueBinaryDataSet(this, bs.start, UINT(bs.length), T_BYTES, 0); }
       value( const std::vector<byte>& bs) { ValueInit(this); ValueBinaryDataSet(this, &bs[0], UINT(bs.size()), T_BYTES, 0); }
 
-      value( const value* arr, unsigned n )  { ValueInit(this); for( unsigned i = 0; i < n; ++i ) set_item(int(i),arr[i]); }
+      value( const value* arr, unsigned n )  { ValueInit(this); if( n ) ValueArraySetRange(this, 0, n, arr); }
    template<typename T>
-      value(const std::vector<T>& vec) { ValueInit(this); for (unsigned i = 0; i < vec.size(); ++i) set_item(int(i), value(vec[i])); }
+      value(const std::vector<T>& vec) { ValueInit(this); if( vec.size() ) assign_array(vec.begin(), vec.size()); }
 #ifdef CPP11
    template<typename T, size_t N>
-      value(const std::array<T,N>& arr) { ValueInit(this); for (unsigned i = 0; i < N; ++i) set_item(int(i), value(arr[i])); }
+      value(const std::array<T,N>& arr) { ValueInit(this); if( N ) assign_array(arr.begin(), N); }
       value( const native_function_t& nfr );
 #endif
           
@@ -163,6 +249,38 @@
         return value(aux::bytes(s, len));
       }
 
+      /** Creates typed array (Float32Array, Int32Array, etc. in script) referring to external memory, no copy.
+          The memory shall stay valid until prelease(tag) is called - when the engine drops the last reference to it.
+          On engines before API_VERSION 11 the data gets copied and prelease(tag) is called immediately. */
+      template<typename T>
+        static value wrap_array(T* elements, size_t n, NATIVE_FUNCTOR_RELEASE* prelease = nullptr, void* tag = nullptr)
+        {
+          static_assert(typed_array_units<T>::supported, "unsupported typed array element type");
+          value v;
+          ValueBinaryDataSetExternal(&v, reinterpret_cast<BYTE*>(elements), UINT(n * sizeof(T)), typed_array_units<T>::units, prelease, tag);
+          return v;
+        }
+
+      /** Creates typed array, copy of the elements */
+      template<typename T>
+        static value make_typed_array(aux::slice<T> elements)
+        {
+          static_assert(typed_array_units<T>::supported, "unsupported typed array element type");
+          value v;
+          ValueBinaryDataSet(&v, reinterpret_cast<LPCBYTE>(elements.start), UINT(elements.length * sizeof(T)), T_BYTES, typed_array_units<T>::units);
+          return v;
+        }
+
+#ifdef CPP11
+      /** Creates typed array that takes ownership of the vector's buffer, no copy */
+      template<typename T>
+        static value make_typed_array(std::vector<T>&& elements)
+        {
+          std::vector<T>* holder = new std::vector<T>(std::move(elements));
+          return wrap_array(holder->data(), holder->size(), &release_vector<T>, holder);
+        }
+#endif
+
 
       /** Creates an array of values packaged into the value 
           Creates an empty array if called with length == 0 */
@@ -170,9 +288,8 @@
       {
         value v;
         ValueIntDataSet(&v, INT(length), T_ARRAY, 0);
-        if( elements ) 
-          for( unsigned int i = 0; i < length; ++i ) 
-           v.set_item(INT(i),elements[i]);
+        if( elements && length ) 
+          ValueArraySetRange(&v, 0, length, elements);
         return v;
       }
 
@@ -198,10 +315,7 @@
       static value make_map(std::initializer_list<std::pair<value, value>> list)
       {
         value result = value::make_map();
-        for (auto& item : list)
-        {
-          result.set_item(item.first, item.second);
-        }
+        result.set_items(list.begin(), unsigned(list.size()));
         return result;
       }
 #endif
@@ -234,6 +348,15 @@
         return v;
       }
 
+#ifdef CPP11
+      // native function made of function pointer, lambda or functor with any number of parameters.
+      // Parameters are converted by get<P>() straight from the engine's argv (aux::wchars and aux::bytes are borrowed),
+      // missing ones get P(). Calls do not allocate, exceptions are returned as make_error(e.what()).
+      template<typename F> static value make_function(F f);
+      // native function that calls (obj->*method)(...), obj shall outlive the function
+      template<typename C, typename M> static value make_method(C* obj, M method);
+#endif
+
       bool is_undefined() const { return t == T_UNDEFINED; }
       bool is_bool() const { return t == T_BOOL; }
       bool is_int() const { return t == T_INT; }
@@ -248,6 +371,7 @@
       bool is_array_like() const { return t == T_ARRAY || (t == T_OBJECT && u == UT_OBJECT_ARRAY); }
       bool is_function() const { return t == T_FUNCTION; }
       bool is_bytes() const { return t == T_BYTES; }
+      bool is_typed_array() const { return t == T_BYTES && u != UT_BYTES_RAW; }
       bool is_object() const { return t == T_OBJECT; }
       //bool is_dom_element() const { return t == T_DOM_OBJECT; }
       // if it is a native functor reference
@@ -316,6 +440,19 @@
         return aux::bytes(b,l);
       }
 
+      // elements of typed array, no copy. Empty if it is not a typed array of T.
+      // Plain bytes are accessible as typed array of uint8_t too.
+      template<typename T>
+        aux::slice<T> get_typed_array() const
+        {
+          if( t != T_BYTES ) return aux::slice<T>();
+          if( INT(u) != INT(typed_array_units<T>::units) && !(u == UT_BYTES_RAW && INT(typed_array_units<T>::units) == UT_BYTES_UINT8) )
+            return aux::slice<T>();
+          LPCBYTE b = 0; UINT l = 0;
+          if( ValueBinaryData(this,&b,&l) != HV_OK ) return aux::slice<T>();
+          return aux::slice<T>(reinterpret_cast<const T*>(b), l / sizeof(T));
+        }
+
       UINT get_color(UINT defv = 0) const 
       {
         UINT v = defv;
@@ -438,6 +575,35 @@
       const value operator[](const value& key) const { return get_item(key); }
       value_key_a operator[](const value& key);
 
+#ifdef CPP11
+      // value at the path of keys - names, indexes or values, in one engine call:
+      //   v.get_path("sections", 2, "title") is v["sections"][2]["title"] without intermediate values.
+      // Undefined if some element on the path does not exist.
+      // Use get_chars()/get_bytes() of the result to look at string/bytes data without copying.
+      template<typename... K>
+        value get_path(const K&... keys) const
+        {
+          const unsigned N = sizeof...(K);
+          VALUE path[N];
+          bool  owned[N];
+          fill_path(path, owned, keys...);
+          value r;
+          ValueGetValueOfPath(this, N, path, &r);
+          for( unsigned i = 0; i < N; ++i )
+            if( owned[i] ) ValueClear(&path[i]);
+          return r;
+        }
+#endif
+      value get_path(const value* keys, unsigned n) const
+      {
+        value r;
+        ValueGetValueOfPath(this, n, keys, &r);
+        return r;
+      }
+      // v["name"] - the same, the name is converted to symbol once per process, see intern_symbol()
+      const value operator[](const char* name) const { return get_item(name); }
+      value_key_a operator[](const char* name);
+
 #ifdef CPP11
       typedef std::function<bool(const value& key, const value& val)> key_value_cb;
 #endif
@@ -495,6 +661,29 @@
       {
         ValueNthElementValueSet( this, length(), &v);
       }
+
+      // if it is an array - sets n elements starting from first, expanding the array if needed,
+      // otherwise it converts this to array. One engine call for all elements.
+      void set_items(int first, const value* items, unsigned n)
+      {
+        ValueArraySetRange( this, first, n, items );
+      }
+      void append(const value* items, unsigned n)
+      {
+        ValueArraySetRange( this, length(), n, items );
+      }
+
+#ifdef CPP11
+      // if it is a map - sets n key/value pairs in one call,
+      // otherwise it converts this to map.
+      void set_items(const std::pair<value,value>* items, unsigned n);
+#endif
+
+      // capacity hint for arrays and maps that are about to grow
+      void reserve(unsigned capacity)
+      {
+        ValueReserve( this, capacity );
+      }
       // if it is a map - sets named value in the map;
       // if it is a function - sets named argument of the function;
       // otherwise it converts this to map and adds key/v to it.
@@ -505,6 +694,12 @@
       }
       void set_item(const char* name, const value& v)
       {
+#ifdef CPP11
+        if( const value* pkey = intern_symbol(name) ) {
+          ValueSetValueToKey( this,pkey,&v );
+          return;
+        }
+#endif
         value key(name);
         ValueSetValueToKey( this,&key,&v );
       }
@@ -522,8 +717,14 @@
           \return \b #value under that key if this value is a map/object containing that key, otherwise undefined value */
       value get_item(const char* name) const
       {
-        value key(name);
         value r;
+#ifdef CPP11
+        if( const value* pkey = intern_symbol(name) ) {
+          ValueGetValueOfKey( this, pkey, &r);
+          return r;
+        }
+#endif
+        value key(name);
         ValueGetValueOfKey( this, &key, &r);
         return r;
       }
@@ -621,33 +822,203 @@
     inline std::vector<byte>
       getter(const value& v, std::vector<byte>*) { aux::bytes bs = v.get_bytes(); return std::vector<byte>(bs.start, bs.end()); }
 
+    inline aux::bytes getter(const value& v, aux::bytes*) { return v.get_bytes(); }
+    inline aux::wchars getter(const value& v, aux::wchars*) { return v.get_chars(); }
+    template<typename T> inline aux::slice<T>
+      getter(const value& v, aux::slice<T>*) { return v.get_typed_array<T>(); }
+
     template<typename T> inline std::vector<T>
       getter(const value& v, std::vector<T>*) {
                  std::vector<T> out;
-        if (v.is_array_like()) {
+        if (typed_array_units<T>::supported && v.is_bytes()) {
+          aux::slice<T> elements = v.get_typed_array<T>();
+          out.assign(elements.start, elements.start + elements.length);
+        }
+        else if (v.is_array_like()) {
           int n = v.length();
+          out.reserve(n);
           for (int i = 0; i < n; ++i) out.push_back(v.get_item(i).get<T>());
         }
         return out;
     }
 
-    // setter - free standing conversion of T to azurite::value.
-    // NOTE this function is deliberatly left not implemented - it is just a prototype
-    template<typename T>  
-       inline value setter(const T& v); 
+#ifdef CPP11
+    namespace reflect {
+
+      // field descriptor: key name and pointer to member, see AZURITE_STRUCT below
+      template<typename S, typename M>
+        struct field_t {
+          typedef S struct_type;
+          typedef M member_type;
+          const char* name;
+          M S::*      member;
+          constexpr field_t(const char* n, M S::* m): name(n), member(m) {}
+        };
+
+      template<typename S, typename M>
+        constexpr field_t<S,M> field(const char* name, M S::* member) { return field_t<S,M>(name, member); }
+
+      // key values of the descriptor R, created once and kept for the lifetime of the process (leaked on purpose)
+      template<typename R, size_t I, size_t N> struct fields_walker
+      {
+        template<typename FT> static void keys(const FT& fs, value* keys) {
+          keys[I] = value(std::get<I>(fs).name);
+          fields_walker<R,I + 1,N>::keys(fs,keys);
+        }
+        template<typename FT, typename S> static void put(const FT& fs, const S& s, const value* keys, std::pair<value,value>* items) {
+          items[I].first = keys[I];
+          items[I].second = value(s.*(std::get<I>(fs).member));
+          fields_walker<R,I + 1,N>::put(fs,s,keys,items);
+        }
+        template<typename FT, typename S> static void get(const FT& fs, const value& v, const value* keys, S& s) {
+          typedef typename std::tuple_element<I,FT>::type::member_type M;
+          value fv = v.get_item(keys[I]);
+          if( !fv.is_undefined() )
+            s.*(std::get<I>(fs).member) = fv.get<M>();
+          fields_walker<R,I + 1,N>::get(fs,v,keys,s);
+        }
+      };
+      template<typename R, size_t N> struct fields_walker<R,N,N>
+      {
+        template<typename FT> static void keys(const FT&, value*) {}
+        template<typename FT, typename S> static void put(const FT&, const S&, const value*, std::pair<value,value>*) {}
+        template<typename FT, typename S> static void get(const FT&, const value&, const value*, S&) {}
+      };
+
+      template<typename R>
+        struct fields_of
+        {
+          typedef decltype(R::fields()) tuple_type;
+          enum { count = std::tuple_size<tuple_type>::value };
+          static const value* keys() {
+            static const value* k = make_keys();
+            return k;
+          }
+        private:
+          static const value* make_keys() {
+            value* k = new value[count];
+            fields_walker<R,0,count>::keys(R::fields(), k);
+            return k;
+          }
+        };
+
+      // struct -> map, all fields are passed to the engine in one call
+      template<typename R, typename S>
+        inline value to_value(const S& s, const R&)
+        {
+          typedef fields_of<R> F;
+          std::array<std::pair<value,value>, F::count> items;
+          fields_walker<R,0,F::count>::put(R::fields(), s, F::keys(), items.data());
+          value m = value::make_map();
+          m.set_items(items.data(), unsigned(F::count));
+          return m;
+        }
+
+      // map -> struct, fields missing in the map keep their default values
+      template<typename S, typename R>
+        inline S from_value(const value& v, const R&)
+        {
+          typedef fields_of<R> F;
+          S s = S();
+          if( v.is_map() || v.is_object() )
+            fields_walker<R,0,F::count>::get(R::fields(), v, F::keys(), s);
+          return s;
+        }
+
+      // fills associative container from map in single ValueEnumElements pass
+      template<typename MAP>
+        struct map_filler : value::enum_cb
+        {
+          MAP& out;
+          map_filler(MAP& m): out(m) {}
+          virtual bool on(const value& key, const value& val) {
+            out.emplace(key.get<typename MAP::key_type>(), val.get<typename MAP::mapped_type>());
+            return true;
+          }
+        };
+
+      template<typename MAP>
+        inline value map_to_value(const MAP& m)
+        {
+          std::vector<std::pair<value,value>> items;
+          items.reserve(m.size());
+          for( typename MAP::const_iterator it = m.begin(); it != m.end(); ++it )
+            items.push_back(std::pair<value,value>(value(it->first),value(it->second)));
+          value r = value::make_map();
+          if( items.size() )
+            r.set_items(items.data(), unsigned(items.size()));
+          return r;
+        }
+      template<typename MAP>
+        inline MAP map_from_value(const value& v)
+        {
+          MAP out;
+          if( v.is_map() || v.is_object() ) {
+            map_filler<MAP> filler(out);
+            v.enum_elements(filler);
+          }
+          return out;
+        }
+    }
+
+    // Reflection of plain structs, place it in the namespace of the struct:
+    //
+    //   struct point { int x, y; std::optional<int> z; };
+    //   AZURITE_STRUCT(point, AZURITE_FIELD(x), AZURITE_FIELD(y), AZURITE_FIELD_EX(depth,z))
+    //
+    // After that value(pt) produces {x:..., y:..., depth:...} map and v.get<point>() reads it back.
+    // Fields may be of any type that has getter/setter: scalars, strings, vectors, maps and other reflected structs.
+    #define AZURITE_FIELD(name) azurite::reflect::field(#name, &TC::name)
+    #define AZURITE_FIELD_EX(key,name) azurite::reflect::field(#key, &TC::name)
+    #define AZURITE_STRUCT(type, ...) \
+      struct azurite_reflect_##type { \
+        typedef type TC; \
+        static auto fields() -> decltype(std::make_tuple(__VA_ARGS__)) { return std::make_tuple(__VA_ARGS__); } \
+      }; \
+      inline azurite_reflect_##type azurite_reflect(const type*) { return azurite_reflect_##type(); } \
+      inline type getter(const azurite::value& v, type*) { return azurite::reflect::from_value<type>(v, azurite_reflect_##type()); }
+
+    // setter of reflected struct, see AZURITE_STRUCT
+    template<typename T>
+      inline value setter(const T& v) { return reflect::to_value(v, azurite_reflect(static_cast<const T*>(nullptr))); }
+
+    template<typename K, typename V, typename C, typename A>
+      inline value setter(const std::map<K,V,C,A>& m) { return reflect::map_to_value(m); }
+    template<typename K, typename V, typename C, typename A>
+      inline std::map<K,V,C,A> getter(const value& v, std::map<K,V,C,A>*) { return reflect::map_from_value<std::map<K,V,C,A>>(v); }
+
+    template<typename K, typename V, typename H, typename E, typename A>
+      inline value setter(const std::unordered_map<K,V,H,E,A>& m) { return reflect::map_to_value(m); }
+    template<typename K, typename V, typename H, typename E, typename A>
+      inline std::unordered_map<K,V,H,E,A> getter(const value& v, std::unordered_map<K,V,H,E,A>*) { return reflect::map_from_value<std::unordered_map<K,V,H,E,A>>(v); }
+#endif
+
+#ifdef CPP17
+    // std::nullopt <-> undefined (or null)
+    template<typename T>
+      inline value setter(const std::optional<T>& v) { return v ? value(*v) : value(); }
+    template<typename T>
+      inline std::optional<T> getter(const value& v, std::optional<T>*) {
+        if( v.is_undefined() || v.is_null() ) return std::nullopt;
+        return v.get<T>();
+      }
+#endif
       
     // value by key bidirectional proxy/accessor 
     class value_key_a
     {
       friend class value;
-      value& col;
-      value  key;
+      value&       col;
+      value        key;
+      const value* pkey; // interned key, used instead of copy of it
       value_key_a& operator=(const value_key_a& val); // no such thing
+      const value& k() const { return pkey ? *pkey : key; }
     protected:
-      value_key_a( value& c, const value& k ): col(c),key(k) {}
+      value_key_a( value& c, const value& k ): col(c),key(k),pkey(nullptr) {}
+      value_key_a( value& c, const value* interned ): col(c),pkey(interned) {}
     public:
       ~value_key_a() {}
-      value_key_a& operator= (const value& val) { col.set_item(key,val); return *this; }
+      value_key_a& operator= (const value& val) { ValueSetValueToKey(&col, &k(), &val); return *this; }
     };
 
     inline value_key_a 
@@ -670,14 +1041,74 @@
     inline value_idx_a 
         value::operator[](int idx) { return value_idx_a(*this, idx); }
 
+#ifdef CPP11
+    inline bool value::path_key(VALUE& k, const char* name)
+    {
+      if( const value* pk = intern_symbol(name) ) { k = *pk; return false; }
+      aux::a2w as(name);
+      ValueInit(&k);
+      ValueStringDataSet(&k, LPCWSTR(as.c_str()), UINT(as.length()), UT_STRING_SYMBOL);
+      return true;
+    }
+
+    inline const value* intern_symbol(const char* name, uint64_t hash)
+    {
+      static aux::intern_table<VALUE> symbols;
+      const VALUE* pv = symbols.get(name, hash, [](const char* n, VALUE& v) {
+        aux::a2w as(n);
+        ValueInit(&v);
+        ValueStringDataSet(&v, LPCWSTR(as.c_str()), UINT(as.length()), UT_STRING_SYMBOL);
+      });
+      return static_cast<const value*>(pv);
+    }
+#endif
+
+    inline value_key_a
+        value::operator[](const char* name) {
+#ifdef CPP11
+          if( const value* pkey = intern_symbol(name) )
+            return value_key_a(*this, pkey);
+#endif
+          return value_key_a(*this, value(name));
+        }
+
+#ifdef CPP11
+    inline void value::set_items(const std::pair<value,value>* items, unsigned n)
+    {
+      static_assert(sizeof(std::pair<value,value>) == 2 * sizeof(VALUE), "pair<value,value> must be two adjacent VALUEs");
+      ValueMapSetItems( this, n, reinterpret_cast<const VALUE*>(items) );
+    }
+#endif
+
+    template<typename IT>
+      inline void value::assign_array(IT it, size_t n)
+      {
+        const unsigned CHUNK = 64;
+        VALUE chunk[CHUNK];
+        ValueIntDataSet(this, INT(n), T_ARRAY, 0);
+        for( size_t at = 0; at < n; ) {
+          unsigned k = unsigned(n - at < CHUNK ? n - at : CHUNK);
+          for( unsigned i = 0; i < k; ++i, ++it ) {
+            value t(*it);
+            ValueInit(&chunk[i]);
+            std::swap(chunk[i], *static_cast<VALUE*>(&t)); // move, t gets empty one
+          }
+          ValueArraySetRange(this, INT(at), k, chunk);
+          for( unsigned i = 0; i < k; ++i )
+            ValueClear(&chunk[i]);
+          at += k;
+        }
+      }
+
+    // proxies read straight into the new value
     inline value::value(const value_key_a& src) {
       ValueInit(this);
-      *this = src.col.get_item(src.key);
+      ValueGetValueOfKey(&src.col, &src.k(), this);
     }
 
     inline value::value(const value_idx_a& src) {
       ValueInit(this);
-      *this = src.col.get_item(src.idx);
+      ValueNthElementValue(&src.col, src.idx, this);
     }
 
   }
@@ -697,7 +1128,7 @@
         if( func ) { 
           ValueInit(retval);
           value r = func(argc,static_cast<const value*>(argv));
-          ValueCopy(retval,&r);
+          std::swap(*retval, *static_cast<VALUE*>(&r)); // move, no copy
           return true;
         }
         else
@@ -713,7 +1144,7 @@
         native_function* self = static_cast<native_function*>(tag);
         ValueInit(retval);
         value r = self->func(argc,static_cast<const value*>(argv));
-        ValueCopy(retval,&r);
+        std::swap(*retval, *static_cast<VALUE*>(&r));
       }
       static VOID release_impl( VOID* tag ) 
       {
@@ -728,133 +1159,144 @@
       ValueNativeFunctorSet(this, native_function::invoke_impl, native_function::release_impl, pnf );
     }
 
-    // value(native function) is a wrapper that produces azurite::value from native function
-    // see uminimal sample 
+    // thunks of value::make_function() and value::make_method():
+    // NATIVE_FUNCTOR_INVOKE implementations generated for the exact signature of the callee
+    namespace thunk {
 
-    template<typename R> 
-    inline value setter(R(*func)()) {
-      native_function_t tf = [func](unsigned int argc, const value* argv) -> value { R r = func(); return value(r); };
-      return value(tf);
-    }
+      template<size_t... I> struct indices {};
+      template<size_t N, size_t... I> struct make_indices : make_indices<N - 1, N - 1, I...> {};
+      template<size_t... I> struct make_indices<0, I...> { typedef indices<I...> type; };
 
-    template<typename R, typename T1> 
-    inline value setter( R(*func)(T1 t1) ) {
-      native_function_t tf = [func](unsigned int argc, const value* argv) -> value {
-        R r = func(argc >= 1 ? argv[0].get<T1>() : T1());
-          return value(r); 
-      };
-      return value(tf); 
-    }
+      template<typename P>
+        inline typename std::decay<P>::type arg(UINT argc, const VALUE* argv, UINT n) {
+          typedef typename std::decay<P>::type type;
+          return n < argc ? static_cast<const value*>(argv + n)->get<type>() : type();
+        }
 
-    template<typename R, typename T1, typename T2> 
-    inline value setter( R(*func)(T1 t1,T2 t2) ) {
-      native_function_t tf = [func](unsigned int argc, const value* argv) -> value {
-        R r = func(argc >= 1 ? argv[0].get<T1>() : T1(),
-          argc >= 2 ? argv[1].get<T2>() : T2());
-          return value(r); 
-      };
-      return value(tf); 
-    }
-    template<typename R, typename T1, typename T2, typename T3> 
-    inline value setter( R(*func)(T1 t1,T2 t2,T3 t3) ) {
-      native_function_t tf = [func](unsigned int argc, const value* argv) -> value {
-        R r = func(argc >= 1 ? argv[0].get<T1>() : T1(),
-          argc >= 2 ? argv[1].get<T2>() : T2(),
-          argc >= 3 ? argv[2].get<T3>() : T3());
-          return value(r); 
-      };
-      return value(tf); 
-    }
-    template<typename R, typename T1, typename T2, typename T3, typename T4> 
-    inline value setter( R(*func)(T1 t1,T2 t2,T3 t3,T4 t4) ) {
-      native_function_t tf = [func](unsigned int argc, const value* argv) -> value { 
-          R r = func(argc >= 1? argv[0].get<T1>(): T1(),
-                    argc >= 2? argv[1].get<T2>(): T2(),
-                    argc >= 3? argv[2].get<T3>(): T3(),
-                    argc >= 4? argv[3].get<T4>(): T4()); 
-          return value(r); 
-      }; 
-      return value(tf);
-    }
+      template<typename R, typename... P>
+        struct signature {
+          template<typename F, size_t... I>
+            static void call(F& f, UINT argc, const VALUE* argv, VALUE* retval, indices<I...>) {
+              (void)argc; (void)argv; // unused if there are no parameters
+              value r(f(arg<P>(argc, argv, UINT(I))...));
+              std::swap(*retval, *static_cast<VALUE*>(&r));
+            }
+          template<typename C, typename M, size_t... I>
+            static void call_method(C* obj, M m, UINT argc, const VALUE* argv, VALUE* retval, indices<I...>) {
+              (void)argc; (void)argv;
+              value r((obj->*m)(arg<P>(argc, argv, UINT(I))...));
+              std::swap(*retval, *static_cast<VALUE*>(&r));
+            }
+        };
+      template<typename... P>
+        struct signature<void, P...> {
+          template<typename F, size_t... I>
+            static void call(F& f, UINT argc, const VALUE* argv, VALUE*, indices<I...>) { (void)argc; (void)argv; f(arg<P>(argc, argv, UINT(I))...); }
+          template<typename C, typename M, size_t... I>
+            static void call_method(C* obj, M m, UINT argc, const VALUE* argv, VALUE*, indices<I...>) { (void)argc; (void)argv; (obj->*m)(arg<P>(argc, argv, UINT(I))...); }
+        };
 
-    template<typename R, typename T1, typename T2, typename T3, typename T4, typename T5>
-    inline value setter( R(*func)(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5)) {
-      native_function_t tf = [func](unsigned int argc, const value *argv) -> value {
-        R r = func(argc >= 1 ? argv[0].get<T1>() : T1(),
-          argc >= 2 ? argv[1].get<T2>() : T2(),
-          argc >= 3 ? argv[2].get<T3>() : T3(),
-          argc >= 4 ? argv[3].get<T4>() : T4(),
-          argc >= 5 ? argv[4].get<T5>() : T5());
-        return value(r);
-      };
-      return value(tf);
-    }
-    template<typename R, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
-    inline value setter( R(*func)(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6)) {
-      native_function_t tf = [func](unsigned int argc, const value *argv) -> value {
-        R r = func(argc >= 1 ? argv[0].get<T1>() : T1(),
-          argc >= 2 ? argv[1].get<T2>() : T2(),
-          argc >= 3 ? argv[2].get<T3>() : T3(),
-          argc >= 4 ? argv[3].get<T4>() : T4(),
-          argc >= 5 ? argv[4].get<T5>() : T5(),
-          argc >= 6 ? argv[5].get<T6>() : T6());
-        return value(r);
-      };
-      return value(tf);
-    }
+      // signature of functions, function pointers, lambdas and functors
+      template<typename F> struct callable : callable<decltype(&F::operator())> {};
+      template<typename R, typename... P> struct callable<R(P...)> { typedef signature<R, P...> type; typedef typename make_indices<sizeof...(P)>::type seq; };
+      template<typename R, typename... P> struct callable<R(*)(P...)> : callable<R(P...)> {};
+      template<typename C, typename R, typename... P> struct callable<R(C::*)(P...)> : callable<R(P...)> {};
+      template<typename C, typename R, typename... P> struct callable<R(C::*)(P...) const> : callable<R(P...)> {};
+#ifdef CPP17
+      // noexcept is part of the function type since C++17
+      template<typename R, typename... P> struct callable<R(P...) noexcept> : callable<R(P...)> {};
+      template<typename R, typename... P> struct callable<R(*)(P...) noexcept> : callable<R(P...)> {};
+      template<typename C, typename R, typename... P> struct callable<R(C::*)(P...) noexcept> : callable<R(P...)> {};
+      template<typename C, typename R, typename... P> struct callable<R(C::*)(P...) const noexcept> : callable<R(P...)> {};
+#endif
 
-    // versions of the above but for generic std::function
-    template<typename R>
-      inline value setter( std::function<R()> func ) 
-      {
-        native_function_t tf = [func](unsigned int argc, const value* argv) -> value { R r = func(); return value(r); };
-        return value(tf);
-      }
+      template<typename F>
+        struct function {
+          F f;
+          explicit function(F&& fn): f(std::move(fn)) {}
+          static VOID invoke(VOID* tag, UINT argc, const VALUE* argv, VALUE* retval) {
+            ValueInit(retval);
+            try { callable<F>::type::call(static_cast<function*>(tag)->f, argc, argv, retval, typename callable<F>::seq()); }
+            catch (std::exception& e) { value err = value::make_error(e.what()); std::swap(*retval, *static_cast<VALUE*>(&err)); }
+          }
+          static VOID release(VOID* tag) { delete static_cast<function*>(tag); }
+        };
 
-    template<typename R,typename P0>
-      inline value setter( std::function<R(P0)> func )
-      {
-        native_function_t tf = [func](unsigned int argc, const value* argv) -> value {
-          R r = func(argc >= 1 ? argv[0].get<P0>() : P0());
-          return value(r);
+      // plain function pointers are passed in the tag - nothing to allocate or release
+      template<typename R, typename... P>
+        struct function<R(*)(P...)> {
+          typedef R(*F)(P...);
+          static VOID invoke(VOID* tag, UINT argc, const VALUE* argv, VALUE* retval) {
+            F f = reinterpret_cast<F>(tag);
+            ValueInit(retval);
+            try { signature<R, P...>::call(f, argc, argv, retval, typename make_indices<sizeof...(P)>::type()); }
+            catch (std::exception& e) { value err = value::make_error(e.what()); std::swap(*retval, *static_cast<VALUE*>(&err)); }
+          }
         };
-        return value(tf);
-      }
-    template<typename R,typename P0,typename P1>
-      inline value setter( std::function<R(P0,P1)> func )
-      {
-        native_function_t tf = [func](unsigned int argc, const value* argv) -> value { 
-          R r = func(argc >= 1? argv[0].get<P0>(): P0(),
-                     argc >= 2? argv[1].get<P1>(): P1() ); 
-          return value(r); 
+#ifdef CPP17
+      template<typename R, typename... P>
+        struct function<R(*)(P...) noexcept> {
+          typedef R(*F)(P...) noexcept;
+          static VOID invoke(VOID* tag, UINT argc, const VALUE* argv, VALUE* retval) {
+            F f = reinterpret_cast<F>(tag);
+            ValueInit(retval);
+            try { signature<R, P...>::call(f, argc, argv, retval, typename make_indices<sizeof...(P)>::type()); }
+            catch (std::exception& e) { value err = value::make_error(e.what()); std::swap(*retval, *static_cast<VALUE*>(&err)); }
+          }
         };
-        return value(tf);
-      }
+#endif
 
-    template<typename R, typename P0, typename P1, typename P2> 
-      inline value setter( std::function<R(P0,P1,P2)> func )
-      {
-        native_function_t tf = [func](unsigned int argc, const value* argv) -> value { 
-          R r = func(argc >= 1? argv[0].get<P0>(): P0(),
-                    argc >= 2? argv[1].get<P1>(): P1(),
-                    argc >= 3? argv[2].get<P2>(): P2()); 
-          return value(r); 
-        }; 
-        return value(tf);
+      template<typename C, typename M>
+        struct method {
+          C* obj;
+          M  m;
+          method(C* o, M mp): obj(o), m(mp) {}
+          static VOID invoke(VOID* tag, UINT argc, const VALUE* argv, VALUE* retval) {
+            method* self = static_cast<method*>(tag);
+            ValueInit(retval);
+            try { callable<M>::type::call_method(self->obj, self->m, argc, argv, retval, typename callable<M>::seq()); }
+            catch (std::exception& e) { value err = value::make_error(e.what()); std::swap(*retval, *static_cast<VALUE*>(&err)); }
+          }
+          static VOID release(VOID* tag) { delete static_cast<method*>(tag); }
+        };
+
+      template<typename F>
+        inline value make(F f, std::false_type /*not a function pointer*/) {
+          value v;
+          ValueNativeFunctorSet(&v, function<F>::invoke, function<F>::release, new function<F>(std::move(f)));
+          return v;
+        }
+      template<typename F>
+        inline value make(F f, std::true_type /*function pointer*/) {
+          value v;
+          ValueNativeFunctorSet(&v, function<F>::invoke, nullptr, reinterpret_cast<VOID*>(f));
+          return v;
+        }
+    }
+
+    template<typename F>
+      inline value value::make_function(F f) {
+        typedef typename std::decay<F>::type FT;
+        return thunk::make<FT>(std::move(f), std::integral_constant<bool, std::is_pointer<FT>::value && std::is_function<typename std::remove_pointer<FT>::type>::value>());
       }
 
-    template<typename R, typename P0, typename P1, typename P2, typename P3> 
-      inline value setter( std::function<R(P0,P1,P2,P3)> func ) {
-        native_function_t tf = [func](unsigned int argc, const value* argv) -> value { 
-            R r = func(argc >= 1? argv[0].get<P0>(): P0(),
-                      argc >= 2? argv[1].get<P1>(): P1(),
-                      argc >= 3? argv[2].get<P2>(): P2(),
-                      argc >= 4? argv[3].get<P3>(): P3()); 
-            return value(r); 
-        }; 
-        return value(tf);
+    template<typename C, typename M>
+      inline value value::make_method(C* obj, M method) {
+        value v;
+        ValueNativeFunctorSet(&v, thunk::method<C, M>::invoke, thunk::method<C, M>::release, new thunk::method<C, M>(obj, method));
+        return v;
       }
 
+    // value(native function) is a wrapper that produces azurite::value from native function
+    // see uminimal sample 
+
+    template<typename R, typename... P>
+      inline value setter(R(*func)(P...)) { return value::make_function(func); }
+
+    // versions of the above but for generic std::function
+    template<typename R, typename... P>
+      inline value setter(std::function<R(P...)> func) { return value::make_function(std::move(func)); }
+
   }
 #endif
 